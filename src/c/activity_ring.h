@@ -0,0 +1,40 @@
+#pragma once
+
+// The background worker's record of recent steps, shared between the face
+// (src/c/main.c) and the worker (worker_src/c/worker.c). Include after
+// <pebble.h> / <pebble_worker.h>.
+//
+// Steps are kept in 10-second buckets numbered time / 10, so bucket b lives in
+// ring slot b % ACTIVITY_RING_BUCKETS and the ring spans the last hour. The
+// worker persists it across two keys (a persist value tops out at 256 bytes)
+// plus a head holding the newest bucket written; the app and its worker share
+// persistent storage.
+
+#define ACTIVITY_BUCKET_SECONDS   10
+#define ACTIVITY_BUCKETS_PER_MIN  6
+#define ACTIVITY_RING_BUCKETS     360
+#define ACTIVITY_RING_HALF        (ACTIVITY_RING_BUCKETS / 2)
+
+// A slot the worker has no count for: it wasn't running, or the bucket was
+// already underway when it started.
+#define ACTIVITY_BUCKET_UNKNOWN   0xFF
+#define ACTIVITY_BUCKET_MAX       0xFE
+
+#define PERSIST_KEY_ACTIVITY_HEAD   210  // uint32: newest bucket in the ring
+#define PERSIST_KEY_ACTIVITY_RING_A 211  // slots 0..179
+#define PERSIST_KEY_ACTIVITY_RING_B 212  // slots 180..359
+
+// AppWorkerMessage types.
+#define WORKER_MSG_BUCKET   1  // worker -> face: data0 = bucket & 0xFFFF, data1 = steps
+#define WORKER_MSG_FLUSH    2  // face -> worker: persist the ring now
+#define WORKER_MSG_FLUSHED  3  // worker -> face: the persisted ring is current
+
+// The full bucket number for a message's truncated data0, given "now".
+static inline uint32_t activityBucketFromMessage(uint16_t low, time_t now) {
+  uint32_t current = (uint32_t)now / ACTIVITY_BUCKET_SECONDS;
+  uint32_t bucket = (current & 0xFFFF0000u) | low;
+  if (bucket > current) {
+    bucket -= 0x10000u;
+  }
+  return bucket;
+}
@@ -1,50 +1,95 @@
 #include <pebble.h>
+#include "activity_ring.h"
 
 #define SCREENSHOT_RUN false
-
-// Ring radius scales with the display so the ring sits at the same relative
-// position on every platform (basalt/diorite/flint 144x168, chalk 180x180,
-// emery 200x228, gabbro 260x260 round).
-#if defined(PBL_PLATFORM_EMERY)
-  #define DOT_DISTANCE       82
-#elif defined(PBL_PLATFORM_GABBRO)
-  #define DOT_DISTANCE       87
-#else
-  #define DOT_DISTANCE       60
+// Logs the ring's per-frame cost for the frame buffer rasterizer, the
+// graphics_fill_circle path and spoke lines (see benchmarkRing()). Never ship
+// `true`.
+#define RING_BENCHMARK false
+#define RING_BENCHMARK_PASSES 20
+// Energy profile: run the face on a compressed clock (one simulated minute per
+// real second) and log a per-simulated-hour count of every wakeup source plus
+// the CPU time spent in handlers. ENERGY_PROFILE_WALKING synthesizes steps and
+// movement events; off, it profiles an idle wearer. Never ship `true`.
+#define ENERGY_PROFILE false
+#define ENERGY_PROFILE_WALKING false
+#define ENERGY_WALK_STEPS_PER_MIN 110
+// Subsystems a build variant can leave out: wscript passes -DBUILD_<X>=0 (see
+// "Build variants" in the README). Their settings read as off, and their code
+// folds away behind `if (BUILD_<X>)` the same way the flags above do.
+#ifndef BUILD_WEATHER
+#define BUILD_WEATHER true          // weather dot, forecast arc, phone fetches
+#endif
+#ifndef BUILD_BPM
+#define BUILD_BPM true              // heart-rate dot
+#endif
+#ifndef BUILD_CUSTOM_THEME
+#define BUILD_CUSTOM_THEME true     // six-color custom theme
 #endif
+#ifndef BUILD_BUNDLED_FONTS
+#define BUILD_BUNDLED_FONTS true    // Roboto and Montserrat
+#endif
+#ifndef BUILD_LEGACY_CONFIG
+#define BUILD_LEGACY_CONFIG true    // per-tuple saves from other/activehour.html
+#endif
+#ifndef BUILD_EXPORT
+#define BUILD_EXPORT true           // DataLogging minute export
+#endif
+
 #define DOT_SPACING          6
 #define EXTRA_DOT_THRESHOLD  11
 #define DOT_STEP_COUNT       30
 #define DOT_SIZE_DEFAULT     1
 #define DOT_SIZE_BOLD        2
 
-// Vertical positions of the centered text layers, for the platforms that use
-// the 42px system font. The time text is centered at ~0.46 of screen height
-// (above center, to leave room for the date below) with absolute gaps of
-// step->time ~15px and time->date 45px. Gabbro must come before the generic
-// PBL_ROUND check since it's also a round display. Flint (144x168, like
-// diorite) falls through to the rectangular default.
-//
-// emery and gabbro no longer use these: they size the time font to the space
-// inside the ring instead, so their positions are computed in getTextLayout()
-// from the chosen font height.
-#if defined(PBL_PLATFORM_EMERY)
-  #define TIME_Y  83
-  #define STEP_Y  68
-  #define DATE_Y  128
-#elif defined(PBL_PLATFORM_GABBRO)
-  #define TIME_Y  98
-  #define STEP_Y  82
-  #define DATE_Y  143
-#elif defined(PBL_ROUND)
-  #define TIME_Y  61
-  #define STEP_Y  45
-  #define DATE_Y  106
-#else
-  #define TIME_Y  55
-  #define STEP_Y  40
-  #define DATE_Y  100
-#endif
+/* ---------------------------------------------------------------------------
+ * Layout tables
+ *
+ * Everything that differs per platform — ring radius, text positions, which
+ * clock font at which size — is declared once in src/c/layout.json and
+ * compiled by tools/gen_layout.py (run from wscript) into static const tables
+ * for the platform being built. Runtime layout is an index lookup: [fit view]
+ * and [ClockFont] for text, [fit view][bold dots] for the ring. The ring
+ * tables also hold every dot position as an offset from the screen center,
+ * so drawing never touches sin/cos_lookup.
+ * ------------------------------------------------------------------------- */
+#define RING_LEVELS          5   // dots in a full minute's spoke
+
+typedef struct {
+  int8_t x;
+  int8_t y;
+} RingOffset;
+
+typedef struct {
+  int16_t baseDist;                   // radius of each minute's first dot
+  RingOffset inner[60];               // weather / BPM dot, just inside
+  RingOffset dots[60][RING_LEVELS];   // dot i of minute m's spoke
+} RingGeometry;
+
+// Where the three text layers sit and which clock font fills the time layer.
+// Bundled faces load resource[bold]; firmware faces use systemFont[bold].
+typedef struct {
+  int16_t timeY;
+  int16_t stepY;
+  int16_t dateY;
+  int16_t timeH;
+  uint32_t resource[2];
+  const char *systemFont[2];   // NULL for bundled faces
+  bool autoFit;                // resource may be swapped for a measured size
+} FontLayout;
+
+// One bundled size of a clock font, [bold].
+typedef struct {
+  int16_t h;
+  uint32_t resource[2];
+} FontCandidate;
+
+// The step/sleep and date lines' font, [bold].
+typedef struct {
+  const char *key[2];
+} SecondaryFonts;
+
+#include "src/layout_tables.auto.h"
 
 // Persist
 #define PERSIST_DEFAULTS_SET 228483
@@ -80,12 +125,32 @@
 #define PERSIST_KEY_FONT_LECO   27   // bool: LECO time font (system, oversized)
 #define PERSIST_KEY_CENTERED_TIME 28 // bool: 12h mode drops %l's leading space
 #define PERSIST_KEY_BPM         29   // bool: heart rate as a dot inside the ring
-// s_arr spans keys 0..29. Keys 12-14 are retired and 18-23 hold the color ints,
-// so those slots are dead weight in the bool cache — never read via config_get().
-#define NUM_SETTINGS            30
-// Int settings above the bool range (like the custom colors, read separately).
+// Int setting, read separately like the custom colors.
 #define PERSIST_KEY_WAKE_THRESHOLD 30  // steps today before sleep display yields to steps
 #define WAKE_THRESHOLD_DEFAULT     500
+#define PERSIST_KEY_FORECAST    31   // bool: next hour's forecast as an arc inside the ring
+#define PERSIST_KEY_GHOST       32   // bool: typical-hour ghost ticks outside the spokes
+#define PERSIST_KEY_WORKER      33   // bool: run the 10-second background step recorder
+#define PERSIST_KEY_EXPORT      34   // bool: stream finished minutes over DataLogging
+#define PERSIST_KEY_ADAPTIVE    35   // bool: scale dots to the wearer's own step rates
+#define PERSIST_KEY_SPARKLINE   36   // bool: keep the hourly rollup; flick shows it
+#define PERSIST_KEY_SECONDS     37   // bool: seconds arc inside the ring
+#define PERSIST_KEY_SPOKES      38   // bool: each minute as one line, not dots
+#define PERSIST_KEY_ROLLING     39   // bool: trailing 60 minutes, now at the top
+#define PERSIST_KEY_SWEEP       40   // bool: fill the ring with a sweep at launch
+// s_arr spans keys 0..40. Keys 12-14 are retired and 18-23 and 30 hold ints,
+// so those slots are dead weight in the bool cache — never read via config_get().
+#define NUM_SETTINGS            41
+// State caches (not settings, never sent as messages) live from 200 up.
+#define PERSIST_KEY_RING_CACHE  200  // RingCache: the ring as it was at exit
+#define PERSIST_KEY_TYPICAL_HOUR 201 // TypicalHour: averaged levels for one hour
+#define PERSIST_KEY_ADAPTIVE_SCALE 202 // AdaptiveScale: active-minute histogram
+#define PERSIST_KEY_ROLLUP_HEAD 203  // uint32: newest hour in the rollup
+#define PERSIST_KEY_ROLLUP_A    204  // hours 0..83 of the rollup ring
+#define PERSIST_KEY_ROLLUP_B    205  // hours 84..167
+#define PERSIST_KEY_FONT_FIT    206  // FontFitCache: measured clock font sizes
+#define PERSIST_KEY_SETTINGS_REV 207 // int: revision of the last settings blob
+// 210-212 hold the background worker's step ring; see activity_ring.h.
 // Message-only keys 99 (THEME) and 100 (CLOCK_FONT) exist for the Clay config
 // page; pkjs translates them to the radio bools and never sends them here.
 
@@ -102,8 +167,27 @@
 #define CUSTOM_STEPS_DEFAULT      0xAAAAAA
 #define CUSTOM_DATE_DEFAULT       0xAAAAAA
 
-#define KEY_TEMPERATURE 101
+// Key 101 (KEY_TEMPERATURE, a single rounded reading) is retired: the current
+// temperature now rides in the KEY_FORECAST payload.
+// The launch handshake (see "Handshake"): the watch greets with 1, the phone's
+// ready message carries its settings revision.
 #define KEY_JSREADY     102
+// Settings saved from the Clay page arrive as one byte array under this key:
+// a format version and revision, then only the keys that changed since the
+// watch last acknowledged a save. See applySettingsBlob(). From the watch,
+// KEY_SETTINGS = 1 asks the phone to resend everything.
+#define KEY_SETTINGS    103
+#define SETTINGS_BLOB_VERSION 2
+// The next hour's weather, one byte array per refresh. See applyForecastBlob().
+#define KEY_FORECAST    104
+#define FORECAST_BLOB_VERSION 1
+#define FORECAST_STEPS        12    // 5-minute steps: one hour
+#define FORECAST_STEP_SECONDS 300
+// Rain at or above this rate (tenths of mm/h) draws its step of the arc thick.
+#define FORECAST_RAIN_THRESHOLD 1
+// Rides along with the greeting: the bool settings this build compiles out,
+// one key per byte, so the config page can hide their toggles.
+#define KEY_LEFT_OUT    105
 
 
 typedef struct {
@@ -114,8 +198,13 @@ typedef struct {
 } Time;
 
 static Window *s_main_window;
-static TextLayer *s_time_layer, *s_step_count_layer, *s_dayt_layer;
+static TextLayer *s_step_count_layer, *s_dayt_layer;
+// The clock is drawn from a pre-rasterized digit atlas (see "Clock digit
+// atlas" below), so it's a plain Layer rather than a TextLayer.
+static Layer *s_time_layer;
 static Layer *s_canvas_layer;
+// Fills the background under everything else; see "Redraw modes".
+static Layer *s_bg_layer;
 static Time s_last_time;
 // Sized for the longest each can hold, plus the terminator:
 //   steps "%d"        -> up to 6 digits
@@ -123,6 +212,7 @@ static Time s_last_time;
 //                        "10h 23" for any sleep of 10 hours or more)
 //   date  "%a, %b %e" -> "Wed, Sep 22" is 11 chars
 static char s_step_count_buffer[12], s_dayt_buffer[16];
+static char s_time_buffer[] = "00:00";
 
 static int s_dotArray[60];
 static int s_lastStepTotal = 0;
@@ -130,8 +220,136 @@ static int s_lastMinSteps = 0;
 
 static bool s_loadedWithMissingData = true;
 
-static bool hasWeather = false;
-static int weatherTemp;
+// False while a notification or other modal covers the face. Movement-driven
+// redraws and step/sleep polling stop until focus returns; see focus_handler().
+static bool s_inFocus = true;
+
+/* ---------------------------------------------------------------------------
+ * Redraw modes
+ *
+ * Pebble has no partial invalidation: marking any layer dirty re-runs every
+ * update proc in the window. What it does have is a retained frame buffer —
+ * the window background is clear and s_bg_layer paints the color instead, so
+ * a frame whose procs all draw nothing leaves the previous image in place.
+ *
+ * That makes two kinds of frame. A full frame (markCanvasDirty(), used for
+ * everything but the seconds arc and the launch sweep) repaints background,
+ * ring and text. A partial frame (markPartialDirty()) sets s_partialFrame: the
+ * background, clock and canvas procs return early except for whatever is
+ * newly due — arc seconds, swept spokes — and the TextLayers are hidden for
+ * the frame so they aren't drawn over themselves. A full frame requested
+ * while a partial frame is pending wins. The partial state is one-shot: the
+ * canvas clears it once drawn, so any redraw not asked for as partial (a label
+ * update, one the firmware starts itself) is a full frame, and s_bg_layer,
+ * first in the tree, brings the text back before the TextLayers are visited.
+ * ------------------------------------------------------------------------- */
+static bool s_partialFrame = false;
+static bool s_fullPending = false;   // a full frame is requested, not yet drawn
+
+// The seconds arc: drawn through s_secondsShown, and s_secondsDrawn is how
+// far the frame buffer already has it. s_secondsStride is how many seconds
+// each step covers — 1 until the budget check in "Seconds arc" widens it.
+static int s_secondsShown = 0;
+static int s_secondsDrawn = 0;
+static int s_secondsStride = 1;
+static uint32_t s_secondsCostMs = 0;
+static int s_secondsFrames = 0;
+
+// The launch sweep: ring positions below s_sweepShown are revealed (60 = the
+// whole ring, whenever no sweep is running); s_sweepDrawn is how far the frame
+// buffer already has them. See "Launch sweep".
+static int s_sweepShown = 60;
+static int s_sweepDrawn = 60;
+
+// The flick sparkline replaces the text while it's up.
+static bool s_sparklineShown = false;
+
+static void setTextHidden(bool hidden) {
+  layer_set_hidden(s_time_layer, hidden);
+  layer_set_hidden(text_layer_get_layer(s_step_count_layer), hidden);
+  layer_set_hidden(text_layer_get_layer(s_dayt_layer), hidden);
+}
+
+static void markCanvasDirty() {
+  s_fullPending = true;
+  if (s_partialFrame) {
+    s_partialFrame = false;
+    setTextHidden(s_sparklineShown);
+  }
+  layer_mark_dirty(s_canvas_layer);
+}
+
+static void markPartialDirty() {
+  if (!s_fullPending && !s_partialFrame) {
+    s_partialFrame = true;
+    setTextHidden(true);
+  }
+  layer_mark_dirty(s_canvas_layer);
+}
+
+// Forecast steps, decoded in place from KEY_FORECAST. Step k covers the five
+// minutes from s_forecastStart + k * FORECAST_STEP_SECONDS; 0 = no forecast.
+static time_t s_forecastStart = 0;
+static int8_t s_forecastTemp[FORECAST_STEPS];      // °F
+static uint8_t s_forecastPrecip[FORECAST_STEPS];   // tenths of mm/h
+
+// When init() started, for launch latency logging.
+static uint32_t s_launchMs = 0;
+
+/* ---------------------------------------------------------------------------
+ * Phased startup
+ *
+ * init() only does what the first frame needs: settings, the ring as it was
+ * cached at the last exit, the window and the time. Everything else runs on a
+ * chain of app_timer callbacks started by the first frame, so the face is on
+ * screen before any health or phone work begins:
+ *
+ *   STARTUP_SUBSCRIBE  step snapshot, tick/health/battery subscriptions
+ *   STARTUP_HISTORY    health minute-history backfill (the expensive call)
+ *   STARTUP_HANDSHAKE  open AppMessage and greet PebbleKit JS
+ *
+ * Time-to-first-frame and time-to-complete-ring (the first frame drawn after
+ * the backfill) are logged relative to s_launchMs.
+ * ------------------------------------------------------------------------- */
+typedef enum {
+  STARTUP_FIRST_FRAME = 0,
+  STARTUP_SUBSCRIBE,
+  STARTUP_HISTORY,
+  STARTUP_HANDSHAKE,
+  STARTUP_DONE
+} StartupPhase;
+
+#define STARTUP_PHASE_DELAY_MS 50
+
+static StartupPhase s_startupPhase = STARTUP_FIRST_FRAME;
+static bool s_ringCompletePending = false;
+
+// The ring persisted at exit, so the next launch can draw a full hour before
+// health history has been fetched. dots[m] is indexed by wall-clock minute,
+// same as s_dotArray; savedAt dates the entries.
+typedef struct {
+  uint32_t savedAt;
+  uint8_t dots[60];
+} RingCache;
+
+// The ghost ring: for each minute of the hour starting at hourStart, the dot
+// level the wearer typically reaches then. Two 4-bit levels per byte, even
+// minutes in the low nibble; 0 means typically idle (no ghost tick).
+typedef struct {
+  uint32_t hourStart;
+  uint8_t levels[30];
+} TypicalHour;
+
+static TypicalHour s_typicalHour;
+
+// The current minute's 10-second buckets as the worker reports them, for the
+// sub-minute track. Only meaningful while s_subMinuteStart is this minute.
+static uint8_t s_subMinute[ACTIVITY_BUCKETS_PER_MIN];
+static time_t s_subMinuteStart = 0;
+
+// Set once the worker's ring has filled every past minute of the ring, which
+// lets launch skip the minute-history query.
+static bool s_workerCoversHour = false;
 
 static int s_dotSize = DOT_SIZE_DEFAULT;
 
@@ -140,6 +358,7 @@ static int s_batteryLevel = 100;
 
 static bool s_arr[NUM_SETTINGS];
 
+#if defined(PBL_COLOR)
 // Custom theme colors (packed 0xRRGGBB), loaded in config_init().
 static int s_customBg     = CUSTOM_BG_DEFAULT;
 static int s_customTime   = CUSTOM_TIME_DEFAULT;
@@ -147,23 +366,94 @@ static int s_customActive = CUSTOM_DOT_ACTIVE_DEFAULT;
 static int s_customDim    = CUSTOM_DOT_DIM_DEFAULT;
 static int s_customSteps  = CUSTOM_STEPS_DEFAULT;
 static int s_customDate   = CUSTOM_DATE_DEFAULT;
+#endif
 
 // Steps today before the center line stops showing sleep and shows steps.
 static int s_wakeThreshold = WAKE_THRESHOLD_DEFAULT;
 
+// Wall-clock milliseconds, for measuring intervals (wraps harmlessly).
+static uint32_t timeMs() {
+  time_t s;
+  uint16_t ms;
+  time_ms(&s, &ms);
+  return (uint32_t)s * 1000 + ms;
+}
+
+/* ---------------------------------------------------------------------------
+ * Energy profile counters
+ *
+ * Only touched when ENERGY_PROFILE is on; the constant-false checks compile
+ * away otherwise. energyReport() logs and resets them once per simulated hour.
+ * CPU time is wall-clock ms inside the face's own handlers and draw procs, so
+ * sub-millisecond handlers only show up in aggregate.
+ * ------------------------------------------------------------------------- */
+typedef struct {
+  uint16_t minuteTicks;
+  uint16_t healthEvents;
+  uint16_t redraws;
+  uint16_t healthCalls;
+  uint16_t msgsSent;
+  uint16_t msgsReceived;
+  uint16_t persistWrites;
+  uint32_t cpuMs;
+} EnergyCounters;
+
+static EnergyCounters s_energy;
+static int s_energyHour = 0;
+// ENERGY_PROFILE_WALKING's stand-in for today's step count.
+static int s_energySimSteps = 0;
+
+#define ENERGY_COUNT(field) do { if (ENERGY_PROFILE) { s_energy.field++; } } while (0)
+
+static uint32_t energyBegin() {
+  return ENERGY_PROFILE ? timeMs() : 0;
+}
+
+static void energyEnd(uint32_t start) {
+  if (ENERGY_PROFILE) {
+    s_energy.cpuMs += timeMs() - start;
+  }
+}
+
+static void energyReport() {
+  APP_LOG(APP_LOG_LEVEL_INFO, "energy %s h%d: ticks %u health-ev %u redraws %u "
+          "health-api %u msg-out %u msg-in %u persist %u cpu %lu ms",
+          ENERGY_PROFILE_WALKING ? "walking" : "idle", s_energyHour,
+          s_energy.minuteTicks, s_energy.healthEvents, s_energy.redraws,
+          s_energy.healthCalls, s_energy.msgsSent, s_energy.msgsReceived,
+          s_energy.persistWrites, (unsigned long)s_energy.cpuMs);
+  memset(&s_energy, 0, sizeof(s_energy));
+  s_energyHour++;
+}
+
 /* Config */
 
-// Convert a packed 0xRRGGBB value to the nearest Pebble color (auto-quantizes
-// to the 64-color palette, and to black/white on B&W watches like diorite).
+#if defined(PBL_COLOR)
+// Convert a packed 0xRRGGBB value to the nearest color in the 64-color palette.
 static GColor8 hexToGColor(int hex) {
   return GColorFromRGB((hex >> 16) & 0xFF, (hex >> 8) & 0xFF, hex & 0xFF);
 }
+#endif
 
 // Read a persisted int setting, falling back to its default if unset.
 static int readPersistInt(int key, int fallback) {
   return persist_exists(key) ? persist_read_int(key) : fallback;
 }
 
+// Whether this build has the subsystem behind a bool setting.
+static bool settingBuilt(int key) {
+  switch (key) {
+    case PERSIST_KEY_WEATHER:
+    case PERSIST_KEY_FORECAST:     return BUILD_WEATHER;
+    case PERSIST_KEY_BPM:          return BUILD_BPM;
+    case PERSIST_KEY_CLR_CUSTOM:   return BUILD_CUSTOM_THEME;
+    case PERSIST_KEY_FONT_ROBOTO:
+    case PERSIST_KEY_FONT_MONT:    return BUILD_BUNDLED_FONTS;
+    case PERSIST_KEY_EXPORT:       return BUILD_EXPORT;
+    default:                       return true;
+  }
+}
+
 bool config_get(int key) {
   if (SCREENSHOT_RUN) {
     if (key == PERSIST_KEY_CLR_BW) {
@@ -212,18 +502,37 @@ void config_init() {
     // time alters the face's signature look.
     persist_write_bool(PERSIST_KEY_CENTERED_TIME, false);
     persist_write_bool(PERSIST_KEY_BPM, false);
+    // Only ever shown with the weather dot on, so it can default on.
+    persist_write_bool(PERSIST_KEY_FORECAST, true);
+    persist_write_bool(PERSIST_KEY_GHOST, false);
+    // A background worker is a standing battery cost and replaces any other
+    // app's worker, so it's strictly opt-in.
+    persist_write_bool(PERSIST_KEY_WORKER, false);
+    // Only useful with a companion app collecting the stream.
+    persist_write_bool(PERSIST_KEY_EXPORT, false);
+    persist_write_bool(PERSIST_KEY_ADAPTIVE, false);
+    persist_write_bool(PERSIST_KEY_SPARKLINE, false);
+    // Once-a-second wakeups are the biggest battery cost the face can have.
+    persist_write_bool(PERSIST_KEY_SECONDS, false);
+    persist_write_bool(PERSIST_KEY_SPOKES, false);
+    persist_write_bool(PERSIST_KEY_ROLLING, false);
+    persist_write_bool(PERSIST_KEY_SWEEP, false);
   }
 
   for(int i = 0; i < NUM_SETTINGS; i++) {
-    s_arr[i] = persist_read_bool(i);
+    s_arr[i] = settingBuilt(i) && persist_read_bool(i);
   }
 
-  s_customBg     = readPersistInt(PERSIST_KEY_CUSTOM_BG,         CUSTOM_BG_DEFAULT);
-  s_customTime   = readPersistInt(PERSIST_KEY_CUSTOM_TIME,       CUSTOM_TIME_DEFAULT);
-  s_customActive = readPersistInt(PERSIST_KEY_CUSTOM_DOT_ACTIVE, CUSTOM_DOT_ACTIVE_DEFAULT);
-  s_customDim    = readPersistInt(PERSIST_KEY_CUSTOM_DOT_DIM,    CUSTOM_DOT_DIM_DEFAULT);
-  s_customSteps  = readPersistInt(PERSIST_KEY_CUSTOM_STEPS,      CUSTOM_STEPS_DEFAULT);
-  s_customDate   = readPersistInt(PERSIST_KEY_CUSTOM_DATE,       CUSTOM_DATE_DEFAULT);
+#if defined(PBL_COLOR)
+  if (BUILD_CUSTOM_THEME) {
+    s_customBg     = readPersistInt(PERSIST_KEY_CUSTOM_BG,         CUSTOM_BG_DEFAULT);
+    s_customTime   = readPersistInt(PERSIST_KEY_CUSTOM_TIME,       CUSTOM_TIME_DEFAULT);
+    s_customActive = readPersistInt(PERSIST_KEY_CUSTOM_DOT_ACTIVE, CUSTOM_DOT_ACTIVE_DEFAULT);
+    s_customDim    = readPersistInt(PERSIST_KEY_CUSTOM_DOT_DIM,    CUSTOM_DOT_DIM_DEFAULT);
+    s_customSteps  = readPersistInt(PERSIST_KEY_CUSTOM_STEPS,      CUSTOM_STEPS_DEFAULT);
+    s_customDate   = readPersistInt(PERSIST_KEY_CUSTOM_DATE,       CUSTOM_DATE_DEFAULT);
+  }
+#endif
 
   s_wakeThreshold = readPersistInt(PERSIST_KEY_WAKE_THRESHOLD, WAKE_THRESHOLD_DEFAULT);
 
@@ -234,15 +543,30 @@ void config_init() {
   }
 }
 
+#if defined(PBL_BW)
+// One fixed look on the 1-bit watches: every theme quantized to black and
+// white anyway, so the theme ladders and custom colors aren't compiled in and
+// the settings page hides them (Clay's COLOR capability).
+static GColor8 getBackgroundColor() { return GColorBlack; }
+static GColor8 getTimeColor()       { return GColorWhite; }
+static GColor8 getDotMainColor()    { return GColorWhite; }
+static GColor8 getDotDarkColor()    { return GColorDarkGray; }
+static GColor8 getStepCountColor()  { return GColorLightGray; }
+static GColor8 getDateColor()       { return GColorLightGray; }
+#else
+static bool customTheme() {
+  return BUILD_CUSTOM_THEME && config_get(PERSIST_KEY_CLR_CUSTOM);
+}
+
 static GColor8 getBackgroundColor() {
-  if (config_get(PERSIST_KEY_CLR_CUSTOM)) {
+  if (customTheme()) {
     return hexToGColor(s_customBg);
   }
   return GColorBlack;
 }
 
 static GColor8 getTimeColor() {
-  if (config_get(PERSIST_KEY_CLR_CUSTOM)) {
+  if (customTheme()) {
     return hexToGColor(s_customTime);
   } else if (config_get(PERSIST_KEY_CLR_ORANGE)) {
     return GColorOrange;
@@ -262,7 +586,7 @@ static GColor8 getTimeColor() {
 }
 
 static GColor8 getDotMainColor() {
-  if (config_get(PERSIST_KEY_CLR_CUSTOM)) {
+  if (customTheme()) {
     return hexToGColor(s_customActive);
   } else if (config_get(PERSIST_KEY_CLR_ORANGE)) {
     return GColorOrange;
@@ -282,7 +606,7 @@ static GColor8 getDotMainColor() {
 }
 
 static GColor8 getDotDarkColor() {
-  if (config_get(PERSIST_KEY_CLR_CUSTOM)) {
+  if (customTheme()) {
     return hexToGColor(s_customDim);
   } else if (config_get(PERSIST_KEY_CLR_ORANGE)) {
     return GColorDarkGray;
@@ -302,7 +626,7 @@ static GColor8 getDotDarkColor() {
 }
 
 static GColor8 getStepCountColor() {
-  if (config_get(PERSIST_KEY_CLR_CUSTOM)) {
+  if (customTheme()) {
     return hexToGColor(s_customSteps);
   } else if (config_get(PERSIST_KEY_CLR_ORANGE)) {
     return GColorRajah;
@@ -322,7 +646,7 @@ static GColor8 getStepCountColor() {
 }
 
 static GColor8 getDateColor() {
-  if (config_get(PERSIST_KEY_CLR_CUSTOM)) {
+  if (customTheme()) {
     return hexToGColor(s_customDate);
   } else if (config_get(PERSIST_KEY_CLR_ORANGE)) {
     return GColorRajah;
@@ -340,6 +664,7 @@ static GColor8 getDateColor() {
   // BW
   return GColorLightGray;
 }
+#endif
 
 static void clearDate() {
   snprintf(s_dayt_buffer, sizeof(s_dayt_buffer), "            ");
@@ -351,6 +676,25 @@ static void clearSteps() {
   text_layer_set_text(s_step_count_layer, s_step_count_buffer);
 }
 
+/* ---------------------------------------------------------------------------
+ * Sleep / steps switch
+ *
+ * The center line shows last night's sleep until today's steps pass the wake
+ * threshold, then steps for the rest of the day. The crossing is checked once
+ * a minute, not on every label update: checkWakeCrossing() on the minute tick
+ * compares the step snapshot closeMinute() already took, so it costs no
+ * health query, and wakeUp() flips s_awake exactly once. (Metric alerts would
+ * make it an event, but the firmware only delivers them for heart rate, not
+ * step count.) armWakeSwitch() resets the switch once per day. The tick skips
+ * the check while covered; the focus-gained pass runs it instead.
+ *
+ * Sleep is read into s_sleepSeconds on HealthEventSleepUpdate and when the
+ * switch is armed; updateStepsLabel() only formats what's cached.
+ * ------------------------------------------------------------------------- */
+static bool s_awake = false;
+static int s_sleepSeconds = 0;
+static int s_wakeDay = -1;   // tm_mday the switch is armed for
+
 static int getSleepSeconds() {
   HealthMetric metric = HealthMetricSleepSeconds;
   time_t start = time_start_of_today();
@@ -359,10 +703,12 @@ static int getSleepSeconds() {
   // Check the metric has data available for today
   HealthServiceAccessibilityMask mask = health_service_metric_accessible(metric, 
     start, end);
+  ENERGY_COUNT(healthCalls);
   
   if(mask & HealthServiceAccessibilityMaskAvailable) {
     // Data is available!
     int sleeps = (int)health_service_sum_today(metric);
+    ENERGY_COUNT(healthCalls);
     return sleeps;
   } else {
     // No data recorded yet today
@@ -373,7 +719,7 @@ static int getSleepSeconds() {
 
 static void updateStepsLabel() {
   if (config_get(PERSIST_KEY_STEPS)) {
-    if (s_lastStepTotal > s_wakeThreshold) {
+    if (s_awake) {
       // Update step count text
       snprintf(s_step_count_buffer, sizeof(s_step_count_buffer), "%d", s_lastStepTotal);
       text_layer_set_text(s_step_count_layer, s_step_count_buffer);
@@ -381,7 +727,7 @@ static void updateStepsLabel() {
       // Show sleep time. Unsigned modulo bounds both fields to two digits, so
       // "99h 59m" is the longest possible result and the compiler can prove it
       // fits. (The old [7] buffer silently rendered any 10h+ sleep as "10h 23".)
-      int secs = getSleepSeconds();
+      int secs = s_sleepSeconds;
       if (secs < 0) {
         secs = 0;
       }
@@ -393,12 +739,49 @@ static void updateStepsLabel() {
   }
 }
 
+static void refreshSleep() {
+  s_sleepSeconds = getSleepSeconds();
+}
+
+static void wakeUp() {
+  if (s_awake) {
+    return;
+  }
+  s_awake = true;
+  if (s_inFocus) {
+    updateStepsLabel();  // otherwise the refocus pass does it
+  }
+}
+
+// Once per day, and again when the threshold changes.
+static void armWakeSwitch(int mday) {
+  s_wakeDay = mday;
+  s_awake = s_lastStepTotal > s_wakeThreshold;
+  refreshSleep();
+}
+
+static void checkWakeCrossing(int mday) {
+  if (mday != s_wakeDay) {
+    armWakeSwitch(mday);
+    updateStepsLabel();
+  } else if (!s_awake && s_lastStepTotal > s_wakeThreshold) {
+    wakeUp();
+  }
+}
+
+static void setLastTime(struct tm *tick_time) {
+  s_last_time.days = tick_time->tm_mday;
+  s_last_time.hours = tick_time->tm_hour;
+  s_last_time.minutes = tick_time->tm_min;
+  s_last_time.seconds = tick_time->tm_sec;
+}
+
 static void update_time() {
   time_t temp = time(NULL); 
   struct tm *tick_time = localtime(&temp);
 
   // Time
-  static char buffer[] = "00:00";
+  char *buffer = s_time_buffer;
   if(clock_is_24h_style() == true){
     strftime(buffer, sizeof("00:00"), "%k:%M", tick_time);
     if (SCREENSHOT_RUN) {
@@ -419,7 +802,7 @@ static void update_time() {
       memmove(buffer, buffer + 1, strlen(buffer));
     }
   }
-  text_layer_set_text(s_time_layer, buffer);
+  layer_mark_dirty(s_time_layer);
   
   // Date
   if (config_get(PERSIST_KEY_DATE)) {
@@ -428,9 +811,279 @@ static void update_time() {
   }
 }
 
+/* ---------------------------------------------------------------------------
+ * Clock digit atlas
+ *
+ * The clock only ever shows 0-9, ':' and a space, so instead of a TextLayer
+ * re-shaping "00:00" through the font engine every minute, the eleven inked
+ * glyphs are rendered once into a small palettized bitmap and each update is a
+ * handful of blits at the measured advances.
+ *
+ * The atlas stores coverage, not color. Glyphs are rasterized white-on-black,
+ * so on color watches each captured pixel's 2-bit red channel *is* its
+ * antialiasing level (0-3), and on B&W the pixel bit is. The theme colors live
+ * only in the palette, so a color change rewrites four entries and never
+ * touches the font.
+ *
+ * Once built, a bundled font is unloaded — it's only needed again when the
+ * font, weight or layout changes. System fonts cost nothing to keep.
+ * ------------------------------------------------------------------------- */
+#define ATLAS_GLYPH_COLON  10
+#define ATLAS_NUM_GLYPHS   11   // '0'-'9' and ':' — the space is an advance only
+// Glyph cells start on byte boundaries in both the 2-bit and 1-bit formats.
+#define ATLAS_CELL_ALIGN   8
+
+static GBitmap *s_atlas = NULL;
+static GBitmap *s_atlasGlyphs[ATLAS_NUM_GLYPHS];
+static uint8_t s_atlasAdvance[ATLAS_NUM_GLYPHS];
+static uint8_t s_atlasSpaceAdvance = 0;
+// First inked row, relative to the time layer. The font's leading above and
+// below the digits is cropped out of the atlas.
+static int16_t s_atlasTop = 0;
+// Index = coverage: 0 is the background, the last entry the full time color.
+static GColor s_atlasPalette[PBL_IF_COLOR_ELSE(4, 2)];
+
+// Bundled face currently loaded, or NULL when the time is using a system font
+// or the bundled face has already been baked into the atlas and released.
+static GFont s_timeFont = NULL;
+// Font the atlas is built from: s_timeFont, a system font, or NULL once the
+// atlas holds everything needed to draw the clock.
+static GFont s_clockFont = NULL;
+
+static int atlasGlyphIndex(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  return (c == ':') ? ATLAS_GLYPH_COLON : -1;
+}
+
+static void releaseClockAtlas() {
+  for (int i = 0; i < ATLAS_NUM_GLYPHS; i++) {
+    if (s_atlasGlyphs[i] != NULL) {
+      gbitmap_destroy(s_atlasGlyphs[i]);
+      s_atlasGlyphs[i] = NULL;
+    }
+  }
+  if (s_atlas != NULL) {
+    gbitmap_destroy(s_atlas);
+    s_atlas = NULL;
+  }
+}
+
+static void setAtlasColors() {
+  GColor8 bg = getBackgroundColor();
+  GColor8 fg = getTimeColor();
+#if defined(PBL_COLOR)
+  // Blend per channel in Pebble's 2-bit color space, matching the levels the
+  // firmware's own text antialiasing produces.
+  for (int k = 0; k < 4; k++) {
+    s_atlasPalette[k] = (GColor8){ .a = 3,
+                                   .r = (bg.r * (3 - k) + fg.r * k + 1) / 3,
+                                   .g = (bg.g * (3 - k) + fg.g * k + 1) / 3,
+                                   .b = (bg.b * (3 - k) + fg.b * k + 1) / 3 };
+  }
+#else
+  s_atlasPalette[0] = bg;
+  s_atlasPalette[1] = fg;
+#endif
+}
+
+// Coverage of one captured frame buffer pixel. Round displays only store the
+// visible span of each row, so anything outside it reads as background.
+static uint8_t framebufferCoverage(GBitmapDataRowInfo row, int x) {
+  if (x < row.min_x || x > row.max_x) {
+    return 0;
+  }
+#if defined(PBL_COLOR)
+  return ((GColor8){ .argb = row.data[x] }).r;
+#else
+  return (row.data[x / 8] >> (x % 8)) & 1;
+#endif
+}
+
+// Palettized rows are packed most-significant pixel first.
+static void atlasSetCoverage(uint8_t *row, int x, uint8_t coverage) {
+#if defined(PBL_COLOR)
+  int shift = 6 - 2 * (x % 4);
+  row[x / 4] = (row[x / 4] & ~(3 << shift)) | (coverage << shift);
+#else
+  int shift = 7 - (x % 8);
+  row[x / 8] = (row[x / 8] & ~(1 << shift)) | (coverage << shift);
+#endif
+}
+
+// Left edge, in layer coordinates, where glyph cells are rasterized: the middle
+// of the layer, which is inside the visible span on round displays too.
+static int atlasRasterX(GRect bounds, int glyph) {
+  return (bounds.size.w - s_atlasAdvance[glyph]) / 2;
+}
+
+// Rasterize one glyph white-on-black into the time layer's area and capture
+// the frame buffer. The caller must release it.
+static GBitmap *captureAtlasGlyph(GContext *ctx, GRect bounds, int glyph) {
+  char text[2] = { (glyph == ATLAS_GLYPH_COLON) ? ':' : (char)('0' + glyph), 0 };
+  int x = atlasRasterX(bounds, glyph);
+
+  graphics_context_set_fill_color(ctx, GColorBlack);
+  graphics_fill_rect(ctx, bounds, 0, GCornerNone);
+  graphics_context_set_text_color(ctx, GColorWhite);
+  graphics_draw_text(ctx, text, s_clockFont, GRect(x, 0, bounds.size.w - x, bounds.size.h),
+                     GTextOverflowModeWordWrap, GTextAlignmentLeft, NULL);
+  return graphics_capture_frame_buffer(ctx);
+}
+
+static void buildClockAtlas(Layer *layer, GContext *ctx) {
+  GRect bounds = layer_get_bounds(layer);
+  // The time layer is a direct child of the full-screen root layer, so its
+  // frame origin is its position in the frame buffer.
+  GPoint origin = layer_get_frame(layer).origin;
+  GRect measure = GRect(0, 0, bounds.size.w, bounds.size.h);
+
+  // A leading space (12h %l) has no ink, only width: the gap it opens.
+  GSize pair = graphics_text_layout_get_content_size("00", s_clockFont, measure,
+                  GTextOverflowModeWordWrap, GTextAlignmentLeft);
+  GSize spaced = graphics_text_layout_get_content_size("0 0", s_clockFont, measure,
+                    GTextOverflowModeWordWrap, GTextAlignmentLeft);
+  s_atlasSpaceAdvance = spaced.w - pair.w;
+
+  int atlasW = 0;
+  for (int i = 0; i < ATLAS_NUM_GLYPHS; i++) {
+    char text[2] = { (i == ATLAS_GLYPH_COLON) ? ':' : (char)('0' + i), 0 };
+    s_atlasAdvance[i] = graphics_text_layout_get_content_size(text, s_clockFont, measure,
+                          GTextOverflowModeWordWrap, GTextAlignmentLeft).w;
+    atlasW += (s_atlasAdvance[i] + ATLAS_CELL_ALIGN - 1) / ATLAS_CELL_ALIGN * ATLAS_CELL_ALIGN;
+  }
+
+  // Pass 1: find the inked rows across all glyphs.
+  int top = bounds.size.h;
+  int bottom = -1;
+  for (int i = 0; i < ATLAS_NUM_GLYPHS; i++) {
+    GBitmap *fb = captureAtlasGlyph(ctx, bounds, i);
+    if (fb == NULL) {
+      return;
+    }
+    int x0 = origin.x + atlasRasterX(bounds, i);
+    for (int y = 0; y < bounds.size.h; y++) {
+      GBitmapDataRowInfo row = gbitmap_get_data_row_info(fb, origin.y + y);
+      for (int x = 0; x < s_atlasAdvance[i]; x++) {
+        if (framebufferCoverage(row, x0 + x)) {
+          top = (y < top) ? y : top;
+          bottom = (y > bottom) ? y : bottom;
+          break;
+        }
+      }
+    }
+    graphics_release_frame_buffer(ctx, fb);
+  }
+  if (bottom < top) {
+    top = bottom = 0;
+  }
+
+  s_atlas = gbitmap_create_blank_with_palette(GSize(atlasW, bottom - top + 1),
+              PBL_IF_COLOR_ELSE(GBitmapFormat2BitPalette, GBitmapFormat1BitPalette),
+              s_atlasPalette, false);
+  if (s_atlas == NULL) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "No memory for the clock atlas");
+    return;
+  }
+  s_atlasTop = top;
+
+  // Pass 2: copy each glyph's coverage into its cell.
+  int cellX = 0;
+  for (int i = 0; i < ATLAS_NUM_GLYPHS; i++) {
+    GBitmap *fb = captureAtlasGlyph(ctx, bounds, i);
+    if (fb == NULL) {
+      releaseClockAtlas();
+      return;
+    }
+    int x0 = origin.x + atlasRasterX(bounds, i);
+    for (int y = top; y <= bottom; y++) {
+      GBitmapDataRowInfo src = gbitmap_get_data_row_info(fb, origin.y + y);
+      uint8_t *dst = gbitmap_get_data_row_info(s_atlas, y - top).data;
+      for (int x = 0; x < s_atlasAdvance[i]; x++) {
+        atlasSetCoverage(dst, cellX + x, framebufferCoverage(src, x0 + x));
+      }
+    }
+    graphics_release_frame_buffer(ctx, fb);
+
+    s_atlasGlyphs[i] = gbitmap_create_as_sub_bitmap(s_atlas,
+                         GRect(cellX, 0, s_atlasAdvance[i], bottom - top + 1));
+    cellX += (s_atlasAdvance[i] + ATLAS_CELL_ALIGN - 1) / ATLAS_CELL_ALIGN * ATLAS_CELL_ALIGN;
+  }
+
+  // Everything the clock needs is in the atlas now.
+  if (s_timeFont != NULL) {
+    fonts_unload_custom_font(s_timeFont);
+    s_timeFont = NULL;
+  }
+  s_clockFont = NULL;
+}
+
+static void drawClock(Layer *layer, GContext *ctx) {
+  GRect bounds = layer_get_bounds(layer);
+
+  if (s_atlas == NULL && s_clockFont != NULL) {
+    buildClockAtlas(layer, ctx);
+    // The glyph captures drew over this layer's area; put the background back.
+    graphics_context_set_fill_color(ctx, getBackgroundColor());
+    graphics_fill_rect(ctx, bounds, 0, GCornerNone);
+  }
+
+  if (s_atlas == NULL) {
+    // No room for the atlas: shape the text directly, as a TextLayer would.
+    if (s_clockFont != NULL) {
+      graphics_context_set_text_color(ctx, getTimeColor());
+      graphics_draw_text(ctx, s_time_buffer, s_clockFont, bounds,
+                         GTextOverflowModeWordWrap, GTextAlignmentCenter, NULL);
+    }
+    return;
+  }
+
+  // Centered like the TextLayer it replaces: by the sum of the advances.
+  int width = 0;
+  for (const char *c = s_time_buffer; *c; c++) {
+    int glyph = atlasGlyphIndex(*c);
+    width += (glyph < 0) ? s_atlasSpaceAdvance : s_atlasAdvance[glyph];
+  }
+
+  int x = (bounds.size.w - width) / 2;
+  for (const char *c = s_time_buffer; *c; c++) {
+    int glyph = atlasGlyphIndex(*c);
+    if (glyph < 0) {
+      x += s_atlasSpaceAdvance;
+      continue;
+    }
+    GRect cell = gbitmap_get_bounds(s_atlasGlyphs[glyph]);
+    graphics_draw_bitmap_in_rect(ctx, s_atlasGlyphs[glyph],
+                                 GRect(x, s_atlasTop, cell.size.w, cell.size.h));
+    x += s_atlasAdvance[glyph];
+  }
+}
+
+static void time_update_proc(Layer *layer, GContext *ctx) {
+  if (s_partialFrame) {
+    return;
+  }
+  uint32_t energyStart = energyBegin();
+  drawClock(layer, ctx);
+  energyEnd(energyStart);
+}
+
+static void bg_update_proc(Layer *layer, GContext *ctx) {
+  if (s_partialFrame) {
+    return;
+  }
+  if (layer_get_hidden(s_time_layer) != s_sparklineShown) {
+    setTextHidden(s_sparklineShown);
+  }
+  graphics_context_set_fill_color(ctx, getBackgroundColor());
+  graphics_fill_rect(ctx, layer_get_bounds(layer), 0, GCornerNone);
+}
+
 static void setLayerTextColors() {
-  window_set_background_color(s_main_window, getBackgroundColor());
-  text_layer_set_text_color(s_time_layer, getTimeColor());
+  layer_mark_dirty(s_bg_layer);
+  setAtlasColors();
+  layer_mark_dirty(s_time_layer);
   text_layer_set_text_color(s_step_count_layer, getStepCountColor());
   text_layer_set_text_color(s_dayt_layer, getDateColor());
 }
@@ -457,308 +1110,570 @@ static ClockFont getClockFont() {
   return CLOCK_FONT_BITHAM;
 }
 
-// Bitham and LECO are both system fonts, so neither costs resource bytes.
-static GFont systemTimeFont(ClockFont font, bool bold) {
-  if (font == CLOCK_FONT_LECO) {
-    // LECO_60 only exists on the newer platforms, and at 164px wide it only
-    // stays on screen at all on the two big ones. The 144x168 screens fall
-    // back to LECO_42, which has no bold cut — hence the same font either way.
-    // Note: For LECO, always use non-bold.
-#if defined(PBL_PLATFORM_EMERY)
-    // Fitted view pulls the ring in to DOT_DISTANCE 70, a 128px budget, where
-    // LECO_60's 164px is buried in the dots. Only the zoom view is wide enough
-    // (152px) for the oversized look to still read.
-    if (config_get(PERSIST_KEY_FITDOTS)) {
-      return fonts_get_system_font(FONT_KEY_LECO_42_NUMBERS);
-    }
-    return fonts_get_system_font(FONT_KEY_LECO_60_NUMBERS_AM_PM);
-#elif defined(PBL_PLATFORM_GABBRO)
-    // No fit toggle on gabbro, and its 162px budget nearly clears LECO_60.
-    return fonts_get_system_font(FONT_KEY_LECO_60_NUMBERS_AM_PM);
-#else
-    return fonts_get_system_font(FONT_KEY_LECO_42_NUMBERS);
-#endif
-  }
-  return fonts_get_system_font(bold ? FONT_KEY_BITHAM_42_BOLD
-                                    : FONT_KEY_BITHAM_42_LIGHT);
+// The layout rows in use, picked once per settings change by selectLayout().
+// Bitham and LECO rows point at firmware fonts, so neither costs resource
+// bytes; Roboto and Montserrat rows name a bundled resource per weight.
+static const FontLayout *s_fontLayout = &LAYOUT_FONTS[0][0];
+static const SecondaryFonts *s_secondaryFonts = &LAYOUT_SECONDARY[0];
+static const RingGeometry *s_ring = &LAYOUT_RINGS[0];
+
+// s_dotArray is indexed by wall-clock minute; the ring's tables by position,
+// 0 at 12 o'clock. Normally the two coincide. In the rolling window the
+// current minute is pinned to the top, so minute m sits at m - now (mod 60)
+// and the hour runs counter-clockwise from it. Set once per frame in
+// draw_proc; everything that places a minute on the ring goes through
+// ringPos(), so rotating costs an add, not trig.
+static int s_ringRotation = 0;
+// The last minute drawn bright, also set per frame in draw_proc.
+static int s_ringLastElapsed = 0;
+
+static int ringPos(int minute) {
+  return (minute + s_ringRotation) % 60;
 }
 
-// Where the three text layers sit, and how tall the time font is. Bitham always
-// uses the compile-time positions; the bundled faces are sized per layout, so
-// on emery and gabbro they get larger text and their own positions.
-typedef struct {
-  int timeY;
-  int stepY;
-  int dateY;
-  int timeH;
-} TextLayout;
-
 /* ---------------------------------------------------------------------------
- * Layout tuning
- *
- * Per-font pixel nudges applied on top of the layout picked below. Positive
- * moves down, negative moves up. Every face sits differently inside its
- * TextLayer box — Bitham, Roboto, Montserrat and LECO all have different
- * internal leading — so the positions below get each one close and these dial
- * it in by eye. All zeros means "exactly as laid out below", which is where
- * things stand today.
+ * Clock font auto-fit
  *
- * Workflow:
- *   edit a number here
- *   pebble build && pebble install --emulator emery
- *   pebble screenshot --emulator emery shot.png
+ * A bundled row in layout.json is a starting point. The first time a
+ * fit/font/weight combination is used, fitClockFont() loads each size bundled
+ * for this platform (largest first), measures "88:88" and keeps the largest
+ * that clears the ring: 2 × (baseDist − DOT_SPACING), the same budget the
+ * hand-tuned sizes were measured against. The time layer is re-centered on
+ * the chosen height and the step/date lines follow it by half the difference.
  *
- * `time` moves only the clock. `step` and `date` move the lines above and
- * below it, so nudging the clock alone will tighten one gap and open the other
- * — adjust all three if you want the block to move as a unit.
+ * The answer is persisted per [fit][ClockFont][bold] along with the ring it
+ * was measured for, under the layout table version and platform, so later
+ * launches load one font and measure nothing. A new ring radius or table
+ * version re-measures on its own.
  * ------------------------------------------------------------------------- */
-typedef struct {
-  int time;   // clock text
-  int step;   // step / sleep line above it
-  int date;   // date line below it
-} LayoutTune;
-
-static LayoutTune getLayoutTune(ClockFont font) {
-#if defined(PBL_PLATFORM_EMERY)
-  // Emery is the primary tuning target. To tune the zoom view separately from
-  // the fitted one, branch on config_get(PERSIST_KEY_FITDOTS) inside a case:
-  //   case CLOCK_FONT_MONT:
-  //     return config_get(PERSIST_KEY_FITDOTS) ? (LayoutTune){ 0, 0, 0 }
-  //                                            : (LayoutTune){ -2, 0, 0 };
-  switch (font) {
-    case CLOCK_FONT_BITHAM: return (LayoutTune){ 0, 0, 0 };
-    case CLOCK_FONT_ROBOTO: return (LayoutTune){ 0, 0, 0 };
-    case CLOCK_FONT_MONT:   return (LayoutTune){ 0, 0, 0 };
-    case CLOCK_FONT_LECO:   return (LayoutTune){ 0, 0, 0 };
-  }
-#elif defined(PBL_PLATFORM_GABBRO)
-  switch (font) {
-    case CLOCK_FONT_BITHAM: return (LayoutTune){ 0, 0, 0 };
-    case CLOCK_FONT_ROBOTO: return (LayoutTune){ 0, 0, 0 };
-    case CLOCK_FONT_MONT:   return (LayoutTune){ 0, 0, 0 };
-    case CLOCK_FONT_LECO:   return (LayoutTune){ 0, 0, 0 };
-  }
-#else
-  // 144x168 and chalk: every font sits at the original TIME_Y / STEP_Y / DATE_Y,
-  // so these nudge the smaller faces (Roboto 40, Montserrat 36) if they read low.
-  switch (font) {
-    case CLOCK_FONT_BITHAM: return (LayoutTune){ 0, 0, 0 };
-    case CLOCK_FONT_ROBOTO: return (LayoutTune){ 0, 0, 0 };
-    case CLOCK_FONT_MONT:   return (LayoutTune){ 0, 0, 0 };
-    case CLOCK_FONT_LECO:   return (LayoutTune){ 0, 0, 0 };
-  }
-#endif
-  return (LayoutTune){ 0, 0, 0 };
-}
-
-// The layout before tuning. getTextLayout() wraps this and applies the nudges.
-static TextLayout getBaseTextLayout() {
-  TextLayout l;
-  ClockFont font = getClockFont();
+#define FONT_FIT_UNMEASURED 0xFF
 
-  if (font == CLOCK_FONT_BITHAM) {
-    // 42px on every platform, original layout.
-    l.timeH = 42; l.timeY = TIME_Y; l.stepY = STEP_Y; l.dateY = DATE_Y;
-    return l;
-  }
+typedef struct {
+  int16_t baseDist;     // ring the choice was measured against
+  uint8_t candidate;    // index into LAYOUT_FONT_CANDIDATES, or UNMEASURED
+  int8_t shift;         // px the time layer moves down (negative = up)
+} FontFitEntry;
 
-  if (font == CLOCK_FONT_LECO) {
-    // Deliberately oversized in zoom view: LECO 60 measures 164 against a 152
-    // budget on emery and 162 on gabbro, so the digits sit over the innermost
-    // ring dots. Kept that way because the look is the point — but the fitted
-    // view's 128px budget is too tight for it, so that drops to LECO 42.
-#if defined(PBL_PLATFORM_EMERY)
-    if (config_get(PERSIST_KEY_FITDOTS)) {
-      l.timeH = 42; l.timeY = 83; l.stepY = 68; l.dateY = 128;
-    } else {
-      l.timeH = 60; l.timeY = 75; l.stepY = 56; l.dateY = 138;
-    }
-#elif defined(PBL_PLATFORM_GABBRO)
-    l.timeH = 60; l.timeY = 90; l.stepY = 75; l.dateY = 153;
-#else
-    l.timeH = 42; l.timeY = TIME_Y; l.stepY = STEP_Y; l.dateY = DATE_Y;
-#endif
-    return l;
+typedef struct {
+  uint16_t version;     // LAYOUT_TABLE_VERSION
+  uint16_t platform;    // LAYOUT_PLATFORM_ID
+  FontFitEntry entries[2][4][2];   // [fit][ClockFont][bold]
+} FontFitCache;
+
+static FontFitCache s_fontFit;
+static bool s_fontFitLoaded = false;
+static FontLayout s_fittedLayout;
+
+static void loadFontFitCache() {
+  s_fontFitLoaded = true;
+  if (persist_read_data(PERSIST_KEY_FONT_FIT, &s_fontFit, sizeof(s_fontFit)) == sizeof(s_fontFit) &&
+      s_fontFit.version == LAYOUT_TABLE_VERSION &&
+      s_fontFit.platform == LAYOUT_PLATFORM_ID) {
+    return;
   }
+  memset(&s_fontFit, FONT_FIT_UNMEASURED, sizeof(s_fontFit));
+  s_fontFit.version = LAYOUT_TABLE_VERSION;
+  s_fontFit.platform = LAYOUT_PLATFORM_ID;
+}
 
-  // Montserrat's round digits are noticeably wider than Roboto's at the same
-  // size (167 vs 148 at 58px), so it lands a size or two smaller everywhere.
-#if defined(PBL_PLATFORM_EMERY)
-  if (config_get(PERSIST_KEY_FITDOTS)) {
-    // Ring pulled in to DOT_DISTANCE 70 — less room inside it.
-    if (font == CLOCK_FONT_MONT) {
-      l.timeH = 42; l.timeY = 84; l.stepY = 69; l.dateY = 129;
-    } else {
-      l.timeH = 48; l.timeY = 81; l.stepY = 66; l.dateY = 132;
+static void measureClockFont(FontFitEntry *entry, const FontLayout *row,
+                             ClockFont font, int bold, int16_t baseDist) {
+  const FontCandidate *list = LAYOUT_FONT_CANDIDATES[font];
+  int budget = 2 * (baseDist - DOT_SPACING);
+  int chosen = 0;
+  for (int i = 0; i < LAYOUT_MAX_CANDIDATES && list[i].h != 0; i++) {
+    GFont f = fonts_load_custom_font(resource_get_handle(list[i].resource[bold]));
+    GSize size = graphics_text_layout_get_content_size("88:88", f, GRect(0, 0, 400, 200),
+                                                       GTextOverflowModeFill,
+                                                       GTextAlignmentLeft);
+    fonts_unload_custom_font(f);
+    chosen = i;
+    APP_LOG(APP_LOG_LEVEL_INFO, "font fit: %dpx measures %d against %d",
+            list[i].h, size.w, budget);
+    if (size.w <= budget) {
+      break;
     }
-  } else {
-    // Ring left at DOT_DISTANCE 82 — the edge dots crop, but the wider gap
-    // inside the ring buys a much larger time.
-    // "Zoom view": the ring is already cropping at the screen edge here, so the
-    // clock is allowed to run past the ring too. Both faces sit at 58 — Roboto
-    // (148) still clears the ring, Montserrat (167) overlaps the innermost dots
-    // by design, the same trade LECO makes.
-    l.timeH = 58; l.timeY = 74; l.stepY = 55; l.dateY = 137;
-  }
-#elif defined(PBL_PLATFORM_GABBRO)
-  if (font == CLOCK_FONT_MONT) {
-    l.timeH = 54; l.timeY = 93; l.stepY = 78; l.dateY = 150;
-  } else {
-    l.timeH = 60; l.timeY = 90; l.stepY = 75; l.dateY = 153;
   }
-#else
-  // 144x168 and chalk have no headroom: Roboto 42 measures 108 against a 108
-  // budget, so 40 is the largest that clears the ring (Montserrat 36).
-  l.timeH = (font == CLOCK_FONT_MONT) ? 36 : 40;
-  l.timeY = TIME_Y; l.stepY = STEP_Y; l.dateY = DATE_Y;
-#endif
-  return l;
+  entry->baseDist = baseDist;
+  entry->candidate = chosen;
+  entry->shift = (row->timeH - list[chosen].h) / 2;
+  persist_write_data(PERSIST_KEY_FONT_FIT, &s_fontFit, sizeof(s_fontFit));
+  ENERGY_COUNT(persistWrites);
 }
 
-static TextLayout getTextLayout() {
-  TextLayout l = getBaseTextLayout();
-  LayoutTune t = getLayoutTune(getClockFont());
+// Swaps s_fontLayout for a copy sized to the ring, if the row allows it.
+static void fitClockFont(int fit, ClockFont font, int bold) {
+  const FontLayout *row = s_fontLayout;
+  if (!row->autoFit || LAYOUT_FONT_CANDIDATES[font][0].h == 0) {
+    return;
+  }
+  if (!s_fontFitLoaded) {
+    loadFontFitCache();
+  }
+  FontFitEntry *entry = &s_fontFit.entries[fit][font][bold];
+  if (entry->candidate == FONT_FIT_UNMEASURED ||
+      entry->candidate >= LAYOUT_MAX_CANDIDATES ||
+      LAYOUT_FONT_CANDIDATES[font][entry->candidate].h == 0 ||
+      entry->baseDist != s_ring->baseDist) {
+    measureClockFont(entry, row, font, bold, s_ring->baseDist);
+  }
 
-  l.timeY += t.time;
-  l.stepY += t.step;
-  l.dateY += t.date;
+  const FontCandidate *c = &LAYOUT_FONT_CANDIDATES[font][entry->candidate];
+  s_fittedLayout = *row;
+  s_fittedLayout.timeH = c->h;
+  s_fittedLayout.resource[bold] = c->resource[bold];
+  s_fittedLayout.timeY += entry->shift;
+  s_fittedLayout.stepY += entry->shift;
+  s_fittedLayout.dateY -= entry->shift;
+  s_fontLayout = &s_fittedLayout;
+}
 
-  return l;
+static void selectLayout() {
+  int fit = config_get(PERSIST_KEY_FITDOTS) ? 1 : 0;
+  int bold = config_get(PERSIST_KEY_BOLD_DOTS) ? 1 : 0;
+  ClockFont font = getClockFont();
+  s_fontLayout = &LAYOUT_FONTS[fit][font];
+  s_secondaryFonts = &LAYOUT_SECONDARY[fit];
+  s_ring = &LAYOUT_RINGS[LAYOUT_RING_INDEX[fit][bold]];
+  fitClockFont(fit, font, config_get(PERSIST_KEY_BOLD_TEXT) ? 1 : 0);
 }
 
 static void applyTextLayout() {
   GRect bounds = layer_get_bounds(window_get_root_layer(s_main_window));
-  TextLayout l = getTextLayout();
+  const FontLayout *l = s_fontLayout;
 
-  layer_set_frame(text_layer_get_layer(s_time_layer),
-                  GRect(0, l.timeY, bounds.size.w, l.timeH + 8));
+  layer_set_frame(s_time_layer,
+                  GRect(0, l->timeY, bounds.size.w, l->timeH + 8));
   layer_set_frame(text_layer_get_layer(s_step_count_layer),
-                  GRect(0, l.stepY, bounds.size.w, 40));
+                  GRect(0, l->stepY, bounds.size.w, 40));
   layer_set_frame(text_layer_get_layer(s_dayt_layer),
-                  GRect(0, l.dateY, bounds.size.w, 40));
-}
-
-// Bundled face currently loaded, or NULL when the time is using system Bitham.
-// Held so it can be released when the weight, layout or font choice changes.
-static GFont s_timeFont = NULL;
-
-static uint32_t timeFontResource() {
-  bool bold = config_get(PERSIST_KEY_BOLD_TEXT);
-  bool mont = (getClockFont() == CLOCK_FONT_MONT);
-#if defined(PBL_PLATFORM_EMERY)
-  if (config_get(PERSIST_KEY_FITDOTS)) {
-    if (mont) {
-      return bold ? RESOURCE_ID_FONT_MONT_B_42 : RESOURCE_ID_FONT_MONT_L_42;
-    }
-    return bold ? RESOURCE_ID_FONT_TIME_B_48 : RESOURCE_ID_FONT_TIME_L_48;
-  }
-  if (mont) {
-    return bold ? RESOURCE_ID_FONT_MONT_B_58 : RESOURCE_ID_FONT_MONT_L_58;
-  }
-  return bold ? RESOURCE_ID_FONT_TIME_B_58 : RESOURCE_ID_FONT_TIME_L_58;
-#elif defined(PBL_PLATFORM_GABBRO)
-  if (mont) {
-    return bold ? RESOURCE_ID_FONT_MONT_B_54 : RESOURCE_ID_FONT_MONT_L_54;
-  }
-  return bold ? RESOURCE_ID_FONT_TIME_B_60 : RESOURCE_ID_FONT_TIME_L_60;
-#else
-  if (mont) {
-    return bold ? RESOURCE_ID_FONT_MONT_B_36 : RESOURCE_ID_FONT_MONT_L_36;
-  }
-  return bold ? RESOURCE_ID_FONT_TIME_B_40 : RESOURCE_ID_FONT_TIME_L_40;
-#endif
-}
-
-// The step/sleep and date lines. Zoom view has room for a larger pair: measured
-// at "Wed, Sep 22", GOTHIC_24_BOLD is 90px wide, and the ring's inner clearance
-// at the date's y is ~124px there. GOTHIC_28 (115px) would leave almost nothing,
-// so 24 is the largest comfortable step up from 18.
-static GFont secondaryFont(bool bold) {
-#if defined(PBL_PLATFORM_EMERY)
-  if (!config_get(PERSIST_KEY_FITDOTS)) {
-    return fonts_get_system_font(bold ? FONT_KEY_GOTHIC_24_BOLD
-                                      : FONT_KEY_GOTHIC_24);
-  }
-#endif
-  return fonts_get_system_font(bold ? FONT_KEY_GOTHIC_18_BOLD
-                                    : FONT_KEY_GOTHIC_18);
+                  GRect(0, l->dateY, bounds.size.w, 40));
 }
 
 static void setLayerFonts() {
-  bool bold = config_get(PERSIST_KEY_BOLD_TEXT);
-  GFont textFont = secondaryFont(bold);
+  selectLayout();
+
+  int bold = config_get(PERSIST_KEY_BOLD_TEXT) ? 1 : 0;
+  GFont textFont = fonts_get_system_font(s_secondaryFonts->key[bold]);
   text_layer_set_font(s_step_count_layer, textFont);
   text_layer_set_font(s_dayt_layer, textFont);
 
-  // In both branches the layer is pointed at the new font before the old one
-  // is released, so it never references freed memory.
-  GFont previous = s_timeFont;
-  ClockFont font = getClockFont();
-  if (font == CLOCK_FONT_ROBOTO || font == CLOCK_FONT_MONT) {
-    s_timeFont = fonts_load_custom_font(resource_get_handle(timeFontResource()));
-    text_layer_set_font(s_time_layer, s_timeFont);
+  // The old atlas (and any font still held for it) goes; the new one is baked
+  // on the time layer's next draw, once applyTextLayout() has sized it.
+  releaseClockAtlas();
+  if (s_timeFont != NULL) {
+    fonts_unload_custom_font(s_timeFont);
+  }
+  if (s_fontLayout->systemFont[bold] == NULL) {
+    s_timeFont = fonts_load_custom_font(
+        resource_get_handle(s_fontLayout->resource[bold]));
+    s_clockFont = s_timeFont;
   } else {
     // Bitham and LECO come from the firmware — nothing to load or free.
     s_timeFont = NULL;
-    text_layer_set_font(s_time_layer, systemTimeFont(font, bold));
-  }
-  if (previous != NULL) {
-    fonts_unload_custom_font(previous);
+    s_clockFont = fonts_get_system_font(s_fontLayout->systemFont[bold]);
   }
 
   applyTextLayout();
+  layer_mark_dirty(s_time_layer);
 }
 
-void send_initial_js_message() {
-  if (config_get(PERSIST_KEY_WEATHER)) {
-    // Begin dictionary
-    DictionaryIterator *iter;
-    app_message_outbox_begin(&iter);
-  
-    // Add a key-value pair
-    int val = config_get(PERSIST_KEY_WEATHER) ? 1 : 0;
-    dict_write_uint8(iter, PERSIST_KEY_WEATHER, val);
-  
-    // Send the message!
-    app_message_outbox_send();
+// Settings writes skip values that are already stored, so re-saving the page
+// (or the legacy page sending everything) costs no flash writes. Both report
+// whether they wrote.
+static bool persistIntIfChanged(uint32_t key, int value) {
+  if (!persist_exists(key) || persist_read_int(key) != value) {
+    persist_write_int(key, value);
+    ENERGY_COUNT(persistWrites);
+    return true;
   }
+  return false;
 }
 
-static void in_recv_handler(DictionaryIterator *iter, void *context) {
-  // Read tuple for data
-  Tuple *temp_tuple = dict_find(iter, KEY_TEMPERATURE);
-  Tuple *jsr_tuple = dict_find(iter, KEY_JSREADY);
+static bool persistBoolIfChanged(uint32_t key, bool value) {
+  if (!persist_exists(key) || persist_read_bool(key) != value) {
+    persist_write_bool(key, value);
+    ENERGY_COUNT(persistWrites);
+    return true;
+  }
+  return false;
+}
 
-  if (temp_tuple) {
-    weatherTemp = (int)temp_tuple->value->int32;
-    hasWeather = true;
-    layer_mark_dirty(s_canvas_layer);
-  } else if (jsr_tuple) {
-    // Send weather pref to js
-    send_initial_js_message();
-  } else {
-    Tuple *t = dict_read_first(iter);
-    while(t) {
-      if ((t->key >= PERSIST_KEY_CUSTOM_BG && t->key <= PERSIST_KEY_CUSTOM_DATE)
-          || t->key == PERSIST_KEY_WAKE_THRESHOLD) {
-        // Int settings: custom theme colors (packed 0xRRGGBB) and the wake
-        // threshold. Never routed through the boolean cache.
-        persist_write_int(t->key, (int)t->value->int32);
-      } else if (t->type == TUPLE_CSTRING) {
-        // Legacy hosted config page sent booleans as "true"/"false" strings.
-        persist_write_bool(t->key, strcmp(t->value->cstring, "true") == 0);
-      } else {
-        // Clay sends booleans as integers.
-        persist_write_bool(t->key, t->value->int32 != 0);
-      }
-      t = dict_read_next(iter);
-    }
-  
-    // Refresh live store
-    config_init();
-    vibes_short_pulse();
+// Int settings: custom theme colors (packed 0xRRGGBB) and the wake threshold.
+// Never routed through the boolean cache.
+static bool isIntSetting(uint32_t key) {
+  return (key >= PERSIST_KEY_CUSTOM_BG && key <= PERSIST_KEY_CUSTOM_DATE)
+      || key == PERSIST_KEY_WAKE_THRESHOLD;
+}
+
+static uint32_t readBigEndian(const uint8_t *data, int width) {
+  uint32_t value = 0;
+  for (int i = 0; i < width; i++) {
+    value = (value << 8) | data[i];
   }
-  
+  return value;
+}
+
+// Bytes a setting's value takes in a KEY_SETTINGS record.
+static int settingWidth(uint32_t key) {
+  if (key >= PERSIST_KEY_CUSTOM_BG && key <= PERSIST_KEY_CUSTOM_DATE) {
+    return 3;
+  }
+  return key == PERSIST_KEY_WAKE_THRESHOLD ? 2 : 1;
+}
+
+/**
+ * Decode a KEY_SETTINGS blob. Layout (must match index.js):
+ *   [version][revision, uint16 BE]  then records of  [key][value]
+ * where the value's width is implied by the key: 3 bytes big-endian for the
+ * 0xRRGGBB colors, 2 for the wake threshold, 1 for every bool. The revision
+ * is stored for the launch handshake. Returns how many stored values changed.
+ * The blob is checked whole before anything is written: an unknown version, a
+ * key outside the settings (state keys from 200 up must never be reachable
+ * from the phone) or a truncated record drops it.
+ */
+static int applySettingsBlob(const uint8_t *data, int length) {
+  if (length < 3 || data[0] != SETTINGS_BLOB_VERSION) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unknown settings blob version");
+    return 0;
+  }
+  for (int i = 3; i < length; ) {
+    uint32_t key = data[i++];
+    if (key >= NUM_SETTINGS) {
+      APP_LOG(APP_LOG_LEVEL_ERROR, "Settings blob key %d out of range", (int)key);
+      return 0;
+    }
+    i += settingWidth(key);
+    if (i > length) {
+      APP_LOG(APP_LOG_LEVEL_ERROR, "Truncated settings blob");
+      return 0;
+    }
+  }
+
+  persistIntIfChanged(PERSIST_KEY_SETTINGS_REV, (int)readBigEndian(data + 1, 2));
+  int changed = 0;
+  int i = 3;
+  while (i < length) {
+    uint32_t key = data[i++];
+    int width = settingWidth(key);
+    int value = (int)readBigEndian(data + i, width);
+    i += width;
+    bool wrote = isIntSetting(key) ? persistIntIfChanged(key, value)
+                                   : persistBoolIfChanged(key, value != 0);
+    if (wrote) {
+      changed++;
+    }
+  }
+  return changed;
+}
+
+// Current heart rate in bpm, or 0 when there's no sensor or no reading yet.
+static int getCurrentBPM() {
+#if defined(PBL_HEALTH)
+  if (!BUILD_BPM) {
+    return 0;
+  }
+  time_t now = time(NULL);
+  HealthServiceAccessibilityMask mask =
+      health_service_metric_accessible(HealthMetricHeartRateBPM, now, now);
+  ENERGY_COUNT(healthCalls);
+  if (mask & HealthServiceAccessibilityMaskAvailable) {
+    ENERGY_COUNT(healthCalls);
+    return (int)health_service_peek_current_value(HealthMetricHeartRateBPM);
+  }
+#endif
+  return 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * Inner-ring providers
+ *
+ * The dots just inside the ring are indicators, each fed by a provider that
+ * declares which setting shows it, what refreshes it (the minute tick every
+ * cadenceMinutes, a health event, a settings change) and how to color its
+ * value. runProviders() runs only the providers an event is due for;
+ * providerSet() caches the value and dirties the canvas only when it changed.
+ * Drawing reads the cached values — nothing is fetched per frame. Values are
+ * shown positionally, at minute value % 60. Asynchronous sources (weather
+ * comes from the phone) refresh by asking, and land via providerSet() later.
+ * ------------------------------------------------------------------------- */
+#define PROVIDER_NONE              INT16_MIN
+
+#define PROVIDER_EVENT_MINUTE      0x01
+#define PROVIDER_EVENT_HEART_RATE  0x02
+#define PROVIDER_EVENT_SETTINGS    0x04   // launch, settings change, refocus
+
+typedef enum {
+  PROVIDER_WEATHER = 0,
+  PROVIDER_BPM,
+  PROVIDER_COUNT
+} ProviderId;
+
+typedef struct {
+  int settingKey;             // bool setting that turns the dot on
+  uint8_t events;             // PROVIDER_EVENT_* that refresh it
+  uint8_t cadenceMinutes;     // for PROVIDER_EVENT_MINUTE: every n minutes
+  void (*refresh)(void);
+  GColor8 (*color)(int value);
+  int value;                  // cached; PROVIDER_NONE draws nothing
+} Provider;
+
+// Weather colors are fixed, not themeable: ice-blue below 0°F, aqua below 60°,
+// orange above. All three would be white on B&W.
+static GColor8 getWeatherColor(int temp) {
+#if defined(PBL_BW)
+  return GColorWhite;
+#else
+  if (temp < 0) {
+    return GColorCeleste;
+  } else if (temp < 60) {
+    return GColorMediumAquamarine;
+  }
+  return GColorOrange;
+#endif
+}
+
+static GColor8 getBPMColor(int bpm) {
+  return PBL_IF_COLOR_ELSE(GColorFolly, GColorWhite);
+}
+
+// Ask JS to refresh the weather; the answer arrives as KEY_FORECAST. Uses
+// PERSIST_KEY_WEATHER so index.js recognizes it as a refresh signal.
+static void requestWeather() {
+  if (!BUILD_WEATHER) {
+    return;
+  }
+  DictionaryIterator *iter;
+  if (app_message_outbox_begin(&iter) != APP_MSG_OK) {
+    return;
+  }
+  dict_write_uint8(iter, PERSIST_KEY_WEATHER, 1);
+  app_message_outbox_send();
+  ENERGY_COUNT(msgsSent);
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "Sent message to get weather...");
+}
+
+static void providerSet(ProviderId id, int value);
+
+// Heart rate: 72 bpm sits at the 12-minute mark. Zero means no sensor or no
+// reading yet, so nothing draws on watches without heart-rate hardware.
+static void refreshBPM() {
+  int bpm = getCurrentBPM();
+  providerSet(PROVIDER_BPM, bpm > 0 ? bpm : PROVIDER_NONE);
+}
+
+static Provider s_providers[PROVIDER_COUNT] = {
+  [PROVIDER_WEATHER] = {
+    .settingKey = PERSIST_KEY_WEATHER,
+    .events = PROVIDER_EVENT_MINUTE,
+    .cadenceMinutes = 30,
+    .refresh = requestWeather,
+    .color = getWeatherColor,
+    .value = PROVIDER_NONE
+  },
+  [PROVIDER_BPM] = {
+    .settingKey = PERSIST_KEY_BPM,
+    .events = PROVIDER_EVENT_HEART_RATE | PROVIDER_EVENT_SETTINGS,
+    .refresh = refreshBPM,
+    .color = getBPMColor,
+    .value = PROVIDER_NONE
+  }
+};
+
+static void providerSet(ProviderId id, int value) {
+  if (s_providers[id].value == value) {
+    return;
+  }
+  s_providers[id].value = value;
+  if (s_inFocus && config_get(s_providers[id].settingKey)) {
+    markCanvasDirty();
+  }
+}
+
+static void runProviders(uint8_t event, int minute) {
+  for (int id = 0; id < PROVIDER_COUNT; id++) {
+    Provider *p = &s_providers[id];
+    if (!(p->events & event) || !config_get(p->settingKey)) {
+      continue;
+    }
+    if (event == PROVIDER_EVENT_MINUTE && p->cadenceMinutes > 1 &&
+        minute % p->cadenceMinutes != 0) {
+      continue;
+    }
+    p->refresh();
+  }
+}
+
+static void drawProviders(GContext *ctx, GPoint center, const RingGeometry *ring) {
+  for (int id = 0; id < PROVIDER_COUNT; id++) {
+    const Provider *p = &s_providers[id];
+    if (p->value == PROVIDER_NONE || !config_get(p->settingKey)) {
+      continue;
+    }
+    int m = ((p->value % 60) + 60) % 60;   // below-zero temperatures too
+    graphics_context_set_fill_color(ctx, p->color(p->value));
+    graphics_fill_circle(ctx, GPoint(center.x + ring->inner[m].x,
+                                     center.y + ring->inner[m].y), s_dotSize);
+  }
+}
+
+/**
+ * Decode a KEY_FORECAST blob straight into the fixed forecast arrays. Layout
+ * (must match index.js):
+ *   [version][start: uint32 BE unix seconds][current temp: int8 °F][n]
+ *   [n x temp: int8 °F][n x precipitation: uint8, tenths of mm/h]
+ */
+static bool applyForecastBlob(const uint8_t *data, int length) {
+  if (!BUILD_WEATHER) {
+    return false;
+  }
+  if (length < 7 || data[0] != FORECAST_BLOB_VERSION) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Unknown forecast blob version");
+    return false;
+  }
+  int n = data[6];
+  if (length < 7 + 2 * n) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Truncated forecast blob");
+    return false;
+  }
+  providerSet(PROVIDER_WEATHER, (int8_t)data[5]);
+
+  s_forecastStart = (time_t)readBigEndian(data + 1, 4);
+  for (int k = 0; k < FORECAST_STEPS; k++) {
+    // Steps the phone didn't send read as dry at the last known temperature.
+    s_forecastTemp[k] = (k < n) ? (int8_t)data[7 + k] : s_forecastTemp[k > 0 ? k - 1 : 0];
+    s_forecastPrecip[k] = (k < n) ? data[7 + n + k] : 0;
+  }
+  return true;
+}
+
+static void refreshTypicalHour();
+static void subscribeTicks();
+static void syncWorker();
+static void syncMinuteExport();
+static void syncSparkline();
+
+/* ---------------------------------------------------------------------------
+ * Handshake
+ *
+ * One round trip at launch. Once AppMessage is open the watch greets
+ * (KEY_JSREADY = 1) in case the phone's own ready message arrived too early
+ * and was dropped; it also lists the bool settings this build compiles out
+ * (KEY_LEFT_OUT) so the config page can hide them. The phone's ready message
+ * carries its settings revision and, if it has one still covering the coming
+ * minutes, its cached forecast, so the weather dot shows straight away. The watch answers at most once, with
+ * only what it needs: PERSIST_KEY_WEATHER = 1 if the forecast is missing or
+ * older than the refresh cadence, KEY_SETTINGS = 1 if the revisions disagree
+ * (a reinstall on either side) and the phone should resend its settings.
+ * Nothing needed, nothing sent.
+ * ------------------------------------------------------------------------- */
+#define WEATHER_STALE_SECONDS (30 * 60)
+
+static bool forecastStale() {
+  return s_forecastStart == 0 || time(NULL) - s_forecastStart >= WEATHER_STALE_SECONDS;
+}
+
+static void sendHello() {
+  DictionaryIterator *iter;
+  if (app_message_outbox_begin(&iter) != APP_MSG_OK) {
+    return;
+  }
+  dict_write_uint8(iter, KEY_JSREADY, 1);
+  uint8_t leftOut[NUM_SETTINGS];
+  uint16_t numLeftOut = 0;
+  for (int i = 0; i < NUM_SETTINGS; i++) {
+    if (!settingBuilt(i)) {
+      leftOut[numLeftOut++] = (uint8_t)i;
+    }
+  }
+  if (numLeftOut > 0) {
+    dict_write_data(iter, KEY_LEFT_OUT, leftOut, numLeftOut);
+  }
+  app_message_outbox_send();
+  ENERGY_COUNT(msgsSent);
+}
+
+static void answerHandshake(int phoneRevision) {
+  APP_LOG(APP_LOG_LEVEL_INFO, "handshake %lu ms after launch",
+          (unsigned long)(timeMs() - s_launchMs));
+  bool wantWeather = config_get(PERSIST_KEY_WEATHER) && forecastStale();
+  bool wantSettings = phoneRevision != readPersistInt(PERSIST_KEY_SETTINGS_REV, 0);
+  if (!wantWeather && !wantSettings) {
+    return;
+  }
+  DictionaryIterator *iter;
+  if (app_message_outbox_begin(&iter) != APP_MSG_OK) {
+    return;
+  }
+  if (wantWeather) {
+    dict_write_uint8(iter, PERSIST_KEY_WEATHER, 1);
+  }
+  if (wantSettings) {
+    dict_write_uint8(iter, KEY_SETTINGS, 1);
+  }
+  app_message_outbox_send();
+  ENERGY_COUNT(msgsSent);
+}
+
+static void in_recv_handler(DictionaryIterator *iter, void *context) {
+  uint32_t energyStart = energyBegin();
+  ENERGY_COUNT(msgsReceived);
+  int oldWakeThreshold = s_wakeThreshold;
+
+  // Read tuple for data
+  Tuple *forecast_tuple = dict_find(iter, KEY_FORECAST);
+  Tuple *jsr_tuple = dict_find(iter, KEY_JSREADY);
+  Tuple *settings_tuple = dict_find(iter, KEY_SETTINGS);
+
+  // Weather and the handshake (which may carry a cached forecast) touch no
+  // settings, so they stop here.
+  if (forecast_tuple || jsr_tuple) {
+    if (forecast_tuple) {
+      bool first = (s_providers[PROVIDER_WEATHER].value == PROVIDER_NONE);
+      if (applyForecastBlob(forecast_tuple->value->data, forecast_tuple->length) && first) {
+        APP_LOG(APP_LOG_LEVEL_INFO, "first weather dot %lu ms after launch",
+                (unsigned long)(timeMs() - s_launchMs));
+      }
+      markCanvasDirty();
+    }
+    if (jsr_tuple) {
+      answerHandshake((int)jsr_tuple->value->int32);
+    }
+    energyEnd(energyStart);
+    return;
+  }
+
+  int changed = 0;
+  if (settings_tuple) {
+    changed = applySettingsBlob(settings_tuple->value->data, settings_tuple->length);
+  } else if (BUILD_LEGACY_CONFIG) {
+    // One tuple per setting: what the legacy hosted config page sends.
+    Tuple *t = dict_read_first(iter);
+    while(t) {
+      bool wrote;
+      if (isIntSetting(t->key)) {
+        wrote = persistIntIfChanged(t->key, (int)t->value->int32);
+      } else if (t->type == TUPLE_CSTRING) {
+        // Legacy hosted config page sent booleans as "true"/"false" strings.
+        wrote = persistBoolIfChanged(t->key, strcmp(t->value->cstring, "true") == 0);
+      } else {
+        wrote = persistBoolIfChanged(t->key, t->value->int32 != 0);
+      }
+      if (wrote) {
+        changed++;
+      }
+      t = dict_read_next(iter);
+    }
+  }
+  if (changed == 0) {
+    // A re-save, or a resync that found everything already in place.
+    energyEnd(energyStart);
+    return;
+  }
+
+  // Refresh live store
+  config_init();
+  vibes_short_pulse();
   
   /* Update display based on new config data */
   if (!config_get(PERSIST_KEY_DATE)) {
@@ -766,17 +1681,30 @@ static void in_recv_handler(DictionaryIterator *iter, void *context) {
   } else {
     update_time();
   }
+  if (s_wakeThreshold != oldWakeThreshold && s_wakeDay >= 0) {
+    armWakeSwitch(s_wakeDay);
+  }
   if (!config_get(PERSIST_KEY_STEPS)) {
     clearSteps();
   } else {
     updateStepsLabel();
   }
-  
-  send_initial_js_message();
+  refreshTypicalHour();
+  syncWorker();
+  syncMinuteExport();
+  syncSparkline();
+  subscribeTicks();
+  runProviders(PROVIDER_EVENT_SETTINGS, 0);
+  // Weather just turned on: don't wait for the 30-minute cadence.
+  if (config_get(PERSIST_KEY_WEATHER) && forecastStale()) {
+    requestWeather();
+  }
   
   setLayerTextColors();
   setLayerFonts();
-  layer_mark_dirty(s_canvas_layer);
+  markCanvasDirty();
+
+  energyEnd(energyStart);
 }
 
 static void inbox_dropped_callback(AppMessageResult reason, void *context) {
@@ -791,19 +1719,6 @@ static void outbox_sent_callback(DictionaryIterator *iterator, void *context) {
   APP_LOG(APP_LOG_LEVEL_INFO, "Outbox send success!");
 }
 
-// Current heart rate in bpm, or 0 when there's no sensor or no reading yet.
-static int getCurrentBPM() {
-#if defined(PBL_HEALTH)
-  time_t now = time(NULL);
-  HealthServiceAccessibilityMask mask =
-      health_service_metric_accessible(HealthMetricHeartRateBPM, now, now);
-  if (mask & HealthServiceAccessibilityMaskAvailable) {
-    return (int)health_service_peek_current_value(HealthMetricHeartRateBPM);
-  }
-#endif
-  return 0;
-}
-
 static int getTotalStepsToday() {
   HealthMetric metric = HealthMetricStepCount;
   time_t end = time(NULL);
@@ -812,15 +1727,121 @@ static int getTotalStepsToday() {
   // Check the metric has data available for today
   HealthServiceAccessibilityMask mask = health_service_metric_accessible(metric, 
     start, end);
+  ENERGY_COUNT(healthCalls);
+
+  if (ENERGY_PROFILE && ENERGY_PROFILE_WALKING) {
+    // The emulator has no step data: walk a steady pace instead. The real sum
+    // is still made (and counted) wherever it would be, then thrown away, so
+    // the profile's health-api figure matches a real wearer's.
+    if (mask & HealthServiceAccessibilityMaskAvailable) {
+      health_service_sum_today(metric);
+      ENERGY_COUNT(healthCalls);
+    }
+    return s_energySimSteps;
+  }
   
   if(mask & HealthServiceAccessibilityMaskAvailable) {
     int totalSteps = (int)health_service_sum_today(metric);
+    ENERGY_COUNT(healthCalls);
     return totalSteps;
   } else {
     return 0;
   }
 }
 
+/* ---------------------------------------------------------------------------
+ * Adaptive dot scale
+ *
+ * The fixed scale gives a dot per DOT_STEP_COUNT steps, which saturates for a
+ * fast walker and never fills for a slow one. With the setting on, the face
+ * instead keeps a histogram of its wearer's active minutes (any steps at all)
+ * in 16 bins of 10 steps, the last one open-ended — 32 bytes. Each finished
+ * minute adds one count; once the total passes ADAPTIVE_CAP every bin is
+ * halved, so older weeks fade out geometrically and the estimate tracks about
+ * the last week of activity. Active minutes then map to 2-5 dots by quartile:
+ * below the 25th percentile 2 dots, above the 75th a full spoke. Cut points
+ * are recomputed (interpolated within their bin) only when a count lands, and
+ * until ADAPTIVE_MIN_SAMPLES minutes are in the fixed scale stays in charge.
+ * Persisted at the top of each hour and on exit.
+ * ------------------------------------------------------------------------- */
+#define ADAPTIVE_BINS         16
+#define ADAPTIVE_BIN_STEPS    10
+#define ADAPTIVE_CAP          2048
+#define ADAPTIVE_MIN_SAMPLES  120
+
+typedef struct {
+  uint16_t bins[ADAPTIVE_BINS];
+} AdaptiveScale;
+
+static AdaptiveScale s_adaptive;
+static int s_adaptiveCuts[3];          // steps at the 25th/50th/75th percentiles
+static bool s_adaptiveReady = false;   // enough samples to trust the cuts
+static bool s_adaptiveDirty = false;   // counted since the last persist
+
+static void updateAdaptiveCuts() {
+  int total = 0;
+  for (int b = 0; b < ADAPTIVE_BINS; b++) {
+    total += s_adaptive.bins[b];
+  }
+  s_adaptiveReady = (total >= ADAPTIVE_MIN_SAMPLES);
+  if (!s_adaptiveReady) {
+    return;
+  }
+
+  int cum = 0;
+  int q = 0;
+  for (int b = 0; b < ADAPTIVE_BINS && q < 3; b++) {
+    int count = s_adaptive.bins[b];
+    while (q < 3 && cum + count >= total * (q + 1) / 4) {
+      int into = (count > 0) ? (total * (q + 1) / 4 - cum) * ADAPTIVE_BIN_STEPS / count : 0;
+      s_adaptiveCuts[q] = b * ADAPTIVE_BIN_STEPS + into;
+      q++;
+    }
+    cum += count;
+  }
+}
+
+static void loadAdaptiveScale() {
+  if (persist_read_data(PERSIST_KEY_ADAPTIVE_SCALE, &s_adaptive, sizeof(s_adaptive)) != sizeof(s_adaptive)) {
+    memset(&s_adaptive, 0, sizeof(s_adaptive));
+  }
+  updateAdaptiveCuts();
+}
+
+static void saveAdaptiveScale() {
+  if (!s_adaptiveDirty) {
+    return;
+  }
+  persist_write_data(PERSIST_KEY_ADAPTIVE_SCALE, &s_adaptive, sizeof(s_adaptive));
+  ENERGY_COUNT(persistWrites);
+  s_adaptiveDirty = false;
+}
+
+// One finished, measured minute. Idle minutes aren't counted: they'd swamp
+// the distribution and always draw a single dot anyway.
+static void addAdaptiveSample(int steps) {
+  if (!config_get(PERSIST_KEY_ADAPTIVE) || steps <= 0) {
+    return;
+  }
+  int bin = steps / ADAPTIVE_BIN_STEPS;
+  if (bin >= ADAPTIVE_BINS) {
+    bin = ADAPTIVE_BINS - 1;
+  }
+  s_adaptive.bins[bin]++;
+
+  int total = 0;
+  for (int b = 0; b < ADAPTIVE_BINS; b++) {
+    total += s_adaptive.bins[b];
+  }
+  if (total > ADAPTIVE_CAP) {
+    for (int b = 0; b < ADAPTIVE_BINS; b++) {
+      s_adaptive.bins[b] /= 2;
+    }
+  }
+  s_adaptiveDirty = true;
+  updateAdaptiveCuts();
+}
+
 /**
  * Return number of dots that correspond to given step count. 
  * Between 1 and 5. 
@@ -828,17 +1849,27 @@ static int getTotalStepsToday() {
 static int calculateDotsFromMinuteSteps(int numSteps) {
   int dots = 1;
   
-  if (numSteps > 0) {
+  if (numSteps > 0 && config_get(PERSIST_KEY_ADAPTIVE) && s_adaptiveReady) {
+    dots = 2;
+    for (int q = 0; q < 3; q++) {
+      if (numSteps > s_adaptiveCuts[q]) {
+        dots++;
+      }
+    }
+  } else if (numSteps > 0) {
     dots = 2 + (numSteps / DOT_STEP_COUNT);
   }
   
-  if (dots > 5) {
-    dots = 5;
+  if (dots > RING_LEVELS) {
+    dots = RING_LEVELS;
   }
   
   return dots;
 }
 
+// Record i of the trailing hour lands in wall-clock minute (i + 1 + now) % 60.
+// s_dotArray stays in wall-clock order; drawing only ever offsets from it
+// (see ringPos()), whichever way the ring is turned.
 static void fetchPastMinuteSteps() {
   time_t temp = time(NULL); 
   struct tm *tick_time = localtime(&temp);
@@ -857,6 +1888,7 @@ static void fetchPastMinuteSteps() {
   // Obtain the minute-by-minute records
   uint32_t num_records = health_service_get_minute_history(minute_data, 
                                                     max_records, &start, &end);
+  ENERGY_COUNT(healthCalls);
   
   // Print the number of steps for each minute
   for(uint32_t i = 0; i < num_records; i++) {
@@ -877,49 +1909,515 @@ static void fetchPastMinuteSteps() {
   // Free the array
   free(minute_data);
   
-  layer_mark_dirty(s_canvas_layer);
+  markCanvasDirty();
+}
+
+/* ---------------------------------------------------------------------------
+ * Typical hour
+ *
+ * The firmware keeps per-minute step averages by time of day, split weekday /
+ * weekend. Once per hour the face asks for each minute of the current hour
+ * (60 averaged sums, one accessibility check) and packs the resulting dot
+ * levels into s_typicalHour, persisted so a relaunch within the same hour
+ * reuses it. draw_proc only ever reads the table, so the ghost costs no health
+ * calls per frame. Averages under EXTRA_DOT_THRESHOLD steps count as idle —
+ * otherwise the odd step at 3am would ghost every quiet hour.
+ * ------------------------------------------------------------------------- */
+static int typicalLevel(int minute) {
+  uint8_t packed = s_typicalHour.levels[minute / 2];
+  return (minute % 2 == 0) ? (packed & 0x0F) : (packed >> 4);
+}
+
+static time_t currentHourStart() {
+  time_t now = time(NULL);
+  struct tm *t = localtime(&now);
+  return now - t->tm_min * 60 - t->tm_sec;
+}
+
+// True when s_typicalHour describes the hour on the clock.
+static bool typicalHourCurrent() {
+  return s_typicalHour.hourStart == (uint32_t)currentHourStart();
+}
+
+static void refreshTypicalHour() {
+  if (!config_get(PERSIST_KEY_GHOST) || typicalHourCurrent()) {
+    return;
+  }
+  time_t hourStart = currentHourStart();
+
+  TypicalHour cached;
+  if (persist_read_data(PERSIST_KEY_TYPICAL_HOUR, &cached, sizeof(cached)) == sizeof(cached) &&
+      cached.hourStart == (uint32_t)hourStart) {
+    s_typicalHour = cached;
+    return;
+  }
+
+  // Stamped even when there are no averages yet (a new watch), so the face
+  // doesn't retry every minute; it tries again next hour.
+  TypicalHour fresh = { .hourStart = (uint32_t)hourStart };
+  HealthServiceTimeScope scope = HealthServiceTimeScopeDailyWeekdayOrWeekend;
+  HealthServiceAccessibilityMask mask = health_service_metric_averaged_accessible(
+      HealthMetricStepCount, hourStart, hourStart + SECONDS_PER_HOUR, scope);
+  ENERGY_COUNT(healthCalls);
+
+  if (mask & HealthServiceAccessibilityMaskAvailable) {
+    for (int m = 0; m < 60; m++) {
+      time_t from = hourStart + m * 60;
+      int steps = (int)health_service_sum_averaged(HealthMetricStepCount,
+                                                   from, from + 60, scope);
+      ENERGY_COUNT(healthCalls);
+      int level = (steps >= EXTRA_DOT_THRESHOLD) ? calculateDotsFromMinuteSteps(steps) : 0;
+      fresh.levels[m / 2] |= (uint8_t)(level << (4 * (m % 2)));
+    }
+  }
+
+  s_typicalHour = fresh;
+  persist_write_data(PERSIST_KEY_TYPICAL_HOUR, &s_typicalHour, sizeof(s_typicalHour));
+  ENERGY_COUNT(persistWrites);
+  markCanvasDirty();
+}
+
+/* ---------------------------------------------------------------------------
+ * Background worker
+ *
+ * With the setting on, worker_src/c/worker.c records steps in 10-second
+ * buckets whether or not the face is running (see activity_ring.h). The face
+ * never polls it: on launch it asks the worker to persist its ring and reads
+ * that back when the worker answers, and while running it takes each closed
+ * bucket as an AppWorkerMessage. The ring fills past minutes without a
+ * minute-history query; the current minute's buckets draw as a six-pixel
+ * track just inside the ring showing when within the minute you moved.
+ * ------------------------------------------------------------------------- */
+static void syncWorker() {
+  bool wanted = config_get(PERSIST_KEY_WORKER);
+  if (wanted == app_worker_is_running()) {
+    return;
+  }
+  AppWorkerResult result = wanted ? app_worker_launch() : app_worker_kill();
+  APP_LOG(APP_LOG_LEVEL_INFO, "worker %s: %d", wanted ? "launch" : "kill", (int)result);
+}
+
+// Fill the ring's past minutes from the worker's persisted buckets. A minute
+// counts only if all six of its buckets were recorded; the rest keep what
+// health history or the ring cache gave them.
+static void applyWorkerRing() {
+  uint32_t newest;
+  uint8_t *ring = (uint8_t *)malloc(ACTIVITY_RING_BUCKETS);
+  if (ring == NULL) {
+    return;
+  }
+  if (persist_read_data(PERSIST_KEY_ACTIVITY_HEAD, &newest, sizeof(newest)) != sizeof(newest) ||
+      persist_read_data(PERSIST_KEY_ACTIVITY_RING_A, ring, ACTIVITY_RING_HALF) != ACTIVITY_RING_HALF ||
+      persist_read_data(PERSIST_KEY_ACTIVITY_RING_B, ring + ACTIVITY_RING_HALF,
+                        ACTIVITY_RING_HALF) != ACTIVITY_RING_HALF) {
+    free(ring);
+    return;
+  }
+
+  time_t now = time(NULL);
+  time_t minuteStart = now - now % 60;
+  int currentMinute = localtime(&now)->tm_min;
+  int covered = 0;
+
+  for (int back = 1; back < 60; back++) {
+    uint32_t first = (uint32_t)(minuteStart - back * 60) / ACTIVITY_BUCKET_SECONDS;
+    uint32_t last = first + ACTIVITY_BUCKETS_PER_MIN - 1;
+    if (last > newest || newest - first >= ACTIVITY_RING_BUCKETS) {
+      continue;  // not recorded yet, or already overwritten
+    }
+    int steps = 0;
+    bool known = true;
+    for (uint32_t b = first; b <= last && known; b++) {
+      uint8_t v = ring[b % ACTIVITY_RING_BUCKETS];
+      known = (v != ACTIVITY_BUCKET_UNKNOWN);
+      steps += v;
+    }
+    if (known) {
+      s_dotArray[(currentMinute - back + 60) % 60] = calculateDotsFromMinuteSteps(steps);
+      covered++;
+    }
+  }
+
+  // Buckets already closed in the current minute seed the sub-minute track.
+  s_subMinuteStart = minuteStart;
+  for (int k = 0; k < ACTIVITY_BUCKETS_PER_MIN; k++) {
+    uint32_t b = (uint32_t)minuteStart / ACTIVITY_BUCKET_SECONDS + k;
+    s_subMinute[k] = (b <= newest && newest - b < ACTIVITY_RING_BUCKETS)
+                     ? ring[b % ACTIVITY_RING_BUCKETS] : ACTIVITY_BUCKET_UNKNOWN;
+  }
+
+  free(ring);
+  s_workerCoversHour = (covered == 59);
+  APP_LOG(APP_LOG_LEVEL_INFO, "worker ring filled %d minutes", covered);
+  markCanvasDirty();
+}
+
+static void worker_message_handler(uint16_t type, AppWorkerMessage *data) {
+  ENERGY_COUNT(msgsReceived);
+  if (type == WORKER_MSG_FLUSHED) {
+    applyWorkerRing();
+    return;
+  }
+  if (type != WORKER_MSG_BUCKET) {
+    return;
+  }
+
+  time_t now = time(NULL);
+  time_t minuteStart = now - now % 60;
+  time_t bucketStart = (time_t)activityBucketFromMessage(data->data0, now) * ACTIVITY_BUCKET_SECONDS;
+  if (bucketStart < minuteStart) {
+    return;  // closed just before the minute tick; its minute is already done
+  }
+  if (s_subMinuteStart != minuteStart) {
+    s_subMinuteStart = minuteStart;
+    memset(s_subMinute, ACTIVITY_BUCKET_UNKNOWN, sizeof(s_subMinute));
+  }
+  s_subMinute[(bucketStart - minuteStart) / ACTIVITY_BUCKET_SECONDS] = (uint8_t)data->data1;
+  if (data->data1 > 0 && s_inFocus) {
+    markCanvasDirty();
+  }
+}
+
+// Six pixels just inside the ring between this minute and the next, one per
+// 10-second bucket, lit where the worker counted steps.
+static void drawSubMinuteTrack(GContext *ctx, GPoint center, const RingGeometry *ring,
+                               int minute) {
+  time_t now = time(NULL);
+  if (s_subMinuteStart != now - now % 60) {
+    return;
+  }
+  RingOffset from = ring->inner[ringPos(minute)];
+  RingOffset to = ring->inner[ringPos(minute + 1)];
+  graphics_context_set_stroke_color(ctx, getDotMainColor());
+  for (int k = 0; k < ACTIVITY_BUCKETS_PER_MIN; k++) {
+    if (s_subMinute[k] == 0 || s_subMinute[k] == ACTIVITY_BUCKET_UNKNOWN) {
+      continue;
+    }
+    // Bucket centers, at (2k + 1) / 12 of the way to the next minute.
+    int num = 2 * k + 1;
+    int den = 2 * ACTIVITY_BUCKETS_PER_MIN;
+    graphics_draw_pixel(ctx, GPoint(center.x + from.x + (to.x - from.x) * num / den,
+                                    center.y + from.y + (to.y - from.y) * num / den));
+  }
+}
+
+/* ---------------------------------------------------------------------------
+ * Hourly rollup & sparkline
+ *
+ * Step totals per local hour for the last seven days: 168 uint16s in a ring
+ * indexed by hour number (local hour start / 3600, rounded down), split over
+ * two persist keys plus a head recording the newest finished hour. In a
+ * half- or quarter-hour zone each sum runs from the local hour start, not the
+ * UTC hour the number names. tick_handler writes it at
+ * each hour boundary with one health_service_sum per newly finished hour;
+ * hours the face wasn't running for are backfilled newest-first, at most
+ * ROLLUP_FILLS_PER_PASS per pass, so a first run fills the week over a few
+ * hours instead of all at once. ROLLUP_UNKNOWN marks hours not filled yet.
+ *
+ * A flick of the wrist swaps the text for a sparkline of today's finished
+ * hours over the same hours yesterday, for SPARKLINE_VIEW_MS. Drawing reads
+ * only the rollup in RAM.
+ * ------------------------------------------------------------------------- */
+#define ROLLUP_HOURS           168
+#define ROLLUP_HALF            (ROLLUP_HOURS / 2)
+#define ROLLUP_UNKNOWN         0xFFFF
+#define ROLLUP_FILLS_PER_PASS  24
+#define SPARKLINE_VIEW_MS      10000
+
+static uint32_t s_rollupNewest = 0;
+static uint16_t s_rollup[ROLLUP_HOURS];
+static AppTimer *s_sparklineTimer = NULL;
+
+static void loadRollup() {
+  if (persist_read_data(PERSIST_KEY_ROLLUP_HEAD, &s_rollupNewest, sizeof(s_rollupNewest)) != sizeof(s_rollupNewest) ||
+      persist_read_data(PERSIST_KEY_ROLLUP_A, s_rollup, sizeof(uint16_t) * ROLLUP_HALF) != (int)(sizeof(uint16_t) * ROLLUP_HALF) ||
+      persist_read_data(PERSIST_KEY_ROLLUP_B, s_rollup + ROLLUP_HALF, sizeof(uint16_t) * ROLLUP_HALF) != (int)(sizeof(uint16_t) * ROLLUP_HALF)) {
+    s_rollupNewest = 0;
+    memset(s_rollup, 0xFF, sizeof(s_rollup));
+  }
+}
+
+static uint16_t rollupAt(uint32_t hour) {
+  if (hour > s_rollupNewest || s_rollupNewest - hour >= ROLLUP_HOURS) {
+    return ROLLUP_UNKNOWN;
+  }
+  return s_rollup[hour % ROLLUP_HOURS];
+}
+
+// Bring the rollup up to the last finished hour. Cheap when already current.
+static void updateRollup() {
+  if (!config_get(PERSIST_KEY_SPARKLINE)) {
+    return;
+  }
+  time_t hourStart = currentHourStart();
+  uint32_t finished = (uint32_t)hourStart / SECONDS_PER_HOUR - 1;
+  // Local hours needn't start on a UTC hour (half- and quarter-hour zones):
+  // hour h is summed from h * 3600 plus the local hour's offset into it.
+  time_t phase = hourStart % SECONDS_PER_HOUR;
+  bool changed = false;
+
+  // Slots between the old head and now hold week-old hours: clear them.
+  if (s_rollupNewest < finished) {
+    uint32_t from = s_rollupNewest + 1;
+    if (finished - from >= ROLLUP_HOURS) {
+      from = finished - ROLLUP_HOURS + 1;
+    }
+    for (uint32_t h = from; h <= finished; h++) {
+      s_rollup[h % ROLLUP_HOURS] = ROLLUP_UNKNOWN;
+    }
+    s_rollupNewest = finished;
+    changed = true;
+  }
+
+  int fills = 0;
+  for (uint32_t back = 0; back < ROLLUP_HOURS && fills < ROLLUP_FILLS_PER_PASS; back++) {
+    uint32_t h = finished - back;
+    if (s_rollup[h % ROLLUP_HOURS] != ROLLUP_UNKNOWN) {
+      continue;
+    }
+    time_t start = (time_t)h * SECONDS_PER_HOUR + phase;
+    HealthServiceAccessibilityMask mask = health_service_metric_accessible(
+        HealthMetricStepCount, start, start + SECONDS_PER_HOUR);
+    ENERGY_COUNT(healthCalls);
+    if (!(mask & HealthServiceAccessibilityMaskAvailable)) {
+      break;  // no history this far back; older hours won't have any either
+    }
+    int steps = (int)health_service_sum(HealthMetricStepCount, start, start + SECONDS_PER_HOUR);
+    ENERGY_COUNT(healthCalls);
+    s_rollup[h % ROLLUP_HOURS] = (uint16_t)(steps >= ROLLUP_UNKNOWN ? ROLLUP_UNKNOWN - 1 : steps);
+    fills++;
+    changed = true;
+  }
+
+  if (changed) {
+    persist_write_data(PERSIST_KEY_ROLLUP_HEAD, &s_rollupNewest, sizeof(s_rollupNewest));
+    ENERGY_COUNT(persistWrites);
+    persist_write_data(PERSIST_KEY_ROLLUP_A, s_rollup, sizeof(uint16_t) * ROLLUP_HALF);
+    ENERGY_COUNT(persistWrites);
+    persist_write_data(PERSIST_KEY_ROLLUP_B, s_rollup + ROLLUP_HALF, sizeof(uint16_t) * ROLLUP_HALF);
+    ENERGY_COUNT(persistWrites);
+  }
+}
+
+static void sparkline_timer_handler(void *context) {
+  s_sparklineTimer = NULL;
+  s_sparklineShown = false;
+  setTextHidden(false);
+  markCanvasDirty();
+}
+
+static void tap_handler(AccelAxisType axis, int32_t direction) {
+  if (s_sparklineTimer != NULL) {
+    app_timer_reschedule(s_sparklineTimer, SPARKLINE_VIEW_MS);
+    return;
+  }
+  s_sparklineShown = true;
+  setTextHidden(true);
+  markCanvasDirty();
+  s_sparklineTimer = app_timer_register(SPARKLINE_VIEW_MS, sparkline_timer_handler, NULL);
+}
+
+static void syncSparkline() {
+  static bool subscribed = false;
+  bool wanted = config_get(PERSIST_KEY_SPARKLINE);
+  if (wanted && !subscribed) {
+    accel_tap_service_subscribe(tap_handler);
+    updateRollup();
+  } else if (!wanted && subscribed) {
+    accel_tap_service_unsubscribe();
+  }
+  subscribed = wanted;
+}
+
+// One polyline of a day's hours across the box, scaled to peak. Unknown hours
+// break the line.
+static void drawSparkSeries(GContext *ctx, GRect box, uint32_t firstHour, int hours, int peak) {
+  GPoint prev = GPointZero;
+  bool havePrev = false;
+  for (int k = 0; k < hours; k++) {
+    uint16_t v = rollupAt(firstHour + k);
+    if (v == ROLLUP_UNKNOWN) {
+      havePrev = false;
+      continue;
+    }
+    GPoint p = GPoint(box.origin.x + k * (box.size.w - 1) / 23,
+                      box.origin.y + box.size.h - 1 - v * (box.size.h - 1) / peak);
+    if (havePrev) {
+      graphics_draw_line(ctx, prev, p);
+    } else {
+      graphics_draw_pixel(ctx, p);
+    }
+    prev = p;
+    havePrev = true;
+  }
+}
+
+static void drawSparkline(GContext *ctx, GPoint center, const RingGeometry *ring) {
+  uint32_t today = (uint32_t)time_start_of_today() / SECONDS_PER_HOUR;
+  uint32_t yesterday = today - 24;
+  int doneToday = (int)(s_rollupNewest + 1 - today);
+  if (doneToday < 0) {
+    doneToday = 0;
+  } else if (doneToday > 24) {
+    doneToday = 24;
+  }
+
+  int peak = 1;
+  for (int k = 0; k < 24; k++) {
+    uint16_t y = rollupAt(yesterday + k);
+    uint16_t t = (k < doneToday) ? rollupAt(today + k) : ROLLUP_UNKNOWN;
+    if (y != ROLLUP_UNKNOWN && y > peak) {
+      peak = y;
+    }
+    if (t != ROLLUP_UNKNOWN && t > peak) {
+      peak = t;
+    }
+  }
+
+  // A box that clears the ring's innermost dots at its corners.
+  int half = (ring->baseDist - DOT_SPACING) * 7 / 10;
+  GRect box = GRect(center.x - half, center.y - half / 2, 2 * half, half);
+
+  graphics_context_set_stroke_width(ctx, 1);
+  graphics_context_set_stroke_color(ctx, getDotDarkColor());
+  drawSparkSeries(ctx, box, yesterday, 24, peak);
+  graphics_context_set_stroke_color(ctx, getDotMainColor());
+  drawSparkSeries(ctx, box, today, doneToday, peak);
+}
+
+/* ---------------------------------------------------------------------------
+ * Minute export
+ *
+ * With the setting on, every finished minute goes to the phone as one 8-byte
+ * MinuteRecord on a DataLogging session. The firmware batches and stores the
+ * records and retries across disconnects, so nothing is buffered on the app
+ * heap and there's no per-minute AppMessage. DataLogging is delivered to
+ * native companion apps (PebbleKit Android/iOS) by tag, not to PebbleKit JS.
+ * ------------------------------------------------------------------------- */
+#define DATALOG_TAG_MINUTES   0x41480001  // "AH", stream 1
+
+#define MINUTE_FLAG_COVERED   0x01  // face was covered; steps weren't measured
+
+typedef struct __attribute__((__packed__)) {
+  uint32_t timestamp;   // start of the minute, UTC seconds
+  uint16_t steps;
+  uint8_t dots;         // the spoke as drawn, 1-5
+  uint8_t flags;
+} MinuteRecord;
+
+static DataLoggingSessionRef s_minuteLog = NULL;
+
+static void syncMinuteExport() {
+  if (BUILD_EXPORT && config_get(PERSIST_KEY_EXPORT) && s_minuteLog == NULL) {
+    s_minuteLog = data_logging_create(DATALOG_TAG_MINUTES, DATA_LOGGING_BYTE_ARRAY,
+                                      sizeof(MinuteRecord), false);
+  } else if (!config_get(PERSIST_KEY_EXPORT) && s_minuteLog != NULL) {
+    data_logging_finish(s_minuteLog);
+    s_minuteLog = NULL;
+  }
+}
+
+// The minute that just ended gets its final count: the live accumulator plus
+// whatever was walked since the last redraw diffed the total. This is also the
+// step snapshot the new minute diffs against. Covered, the face doesn't poll
+// health, so the minute is exported flagged instead.
+static void closeMinute(int minute) {
+  MinuteRecord record = { .flags = 0 };
+
+  if (s_inFocus) {
+    int total = getTotalStepsToday();
+    int delta = total - s_lastStepTotal;
+    int steps = s_lastMinSteps + (delta > 0 ? delta : 0);
+    s_lastStepTotal = total;
+    addAdaptiveSample(steps);
+    s_dotArray[minute] = calculateDotsFromMinuteSteps(steps);
+    record.steps = (uint16_t)(steps > UINT16_MAX ? UINT16_MAX : steps);
+  } else {
+    record.flags |= MINUTE_FLAG_COVERED;
+  }
+
+  if (s_minuteLog != NULL) {
+    time_t now = time(NULL);
+    record.timestamp = (uint32_t)(now - now % 60 - 60);
+    record.dots = (uint8_t)(s_dotArray[minute] > 0 ? s_dotArray[minute] : 1);
+    data_logging_log(s_minuteLog, &record, 1);
+  }
+}
+
+// Seconds ticks only draw the arc; see "Seconds arc".
+static void secondsTick(struct tm *tick_time) {
+  if (!config_get(PERSIST_KEY_SECONDS) || !s_inFocus || s_sparklineShown ||
+      tick_time->tm_sec % s_secondsStride != 0) {
+    return;
+  }
+  s_secondsShown = tick_time->tm_sec;
+  markPartialDirty();
 }
 
-static void tick_handler(struct tm *tick_time, TimeUnits units_changed) {
-  s_last_time.days = tick_time->tm_mday;
-  s_last_time.hours = tick_time->tm_hour;
-  s_last_time.minutes = tick_time->tm_min;
-  s_last_time.seconds = tick_time->tm_sec;
-  
-  // Save total step count
-  s_lastStepTotal = getTotalStepsToday();
-  
-  // Start next minute fresh 
+static void tick_handler(struct tm *tick_time, TimeUnits units_changed) {
+  if (!ENERGY_PROFILE && !(units_changed & MINUTE_UNIT)) {
+    secondsTick(tick_time);
+    return;
+  }
+  uint32_t energyStart = energyBegin();
+  struct tm simulated;
+  if (ENERGY_PROFILE) {
+    // One simulated minute per real second; each wrap closes a simulated hour.
+    simulated = *tick_time;
+    simulated.tm_min = tick_time->tm_sec;
+    tick_time = &simulated;
+    if (tick_time->tm_min == 0) {
+      energyReport();
+    }
+  }
+  ENERGY_COUNT(minuteTicks);
+
+  closeMinute(s_last_time.minutes);
+  setLastTime(tick_time);
+  s_secondsShown = 0;
+
+  // Start next minute fresh (closeMinute() took the step snapshot)
   s_dotArray[s_last_time.minutes] = 1;
   s_lastMinSteps = 0;
+
+  if (!s_inFocus) {
+    // Covered: keep the minute bookkeeping current and nothing else. The
+    // health snapshot, history refetch and redraw all happen once, in the
+    // catch-up pass when focus returns.
+    energyEnd(energyStart);
+    return;
+  }
+
+  // Covered midnights are caught up by focus_gained_handler().
+  checkWakeCrossing(tick_time->tm_mday);
   
   // If face was loaded with missing data and we can get that now, let's do it
   if (s_loadedWithMissingData && tick_time->tm_min % 15 == 1) {
     fetchPastMinuteSteps();
     s_loadedWithMissingData = false;
   }
+
+  // Top of the hour: the ghost moves on to the new hour's averages.
+  refreshTypicalHour();
+  if (tick_time->tm_min == 0) {
+    saveAdaptiveScale();
+    updateRollup();
+  }
   
-  layer_mark_dirty(s_canvas_layer);
+  markCanvasDirty();
   
   update_time();
   
-  if (config_get(PERSIST_KEY_WEATHER)) {
-    // Get weather update every 30 minutes
-    if(tick_time->tm_min % 30 == 0) {
-      // Begin dictionary
-      DictionaryIterator *iter;
-      app_message_outbox_begin(&iter);
+  runProviders(PROVIDER_EVENT_MINUTE, tick_time->tm_min);
 
-      // Ask JS to refresh the weather. Use PERSIST_KEY_WEATHER so app.js
-      // recognizes this as a weather-refresh signal (key 0 was ignored).
-      dict_write_uint8(iter, PERSIST_KEY_WEATHER, 1);
-
-      // Send the message!
-      app_message_outbox_send();
+  energyEnd(energyStart);
+}
 
-      APP_LOG(APP_LOG_LEVEL_DEBUG, "Sent message to get weather...");
-    }
-  }
+// Second ticks only while the seconds arc is on; the energy profile always
+// wants them for its simulated minutes.
+static void subscribeTicks() {
+  bool seconds = ENERGY_PROFILE || config_get(PERSIST_KEY_SECONDS);
+  tick_timer_service_subscribe(seconds ? SECOND_UNIT : MINUTE_UNIT, tick_handler);
 }
 
 /* Return number of dots to show for previous minute. Between 1 and 5. */
@@ -955,10 +2453,484 @@ static int getNumDots() {
   }
 }
 
+/* ---------------------------------------------------------------------------
+ * Ring rasterizer
+ *
+ * Ring dots are radius 0-2 circles, up to 300 of them a frame. Rather than
+ * push each through graphics_fill_circle, drawRing() captures the frame buffer
+ * once and stamps precomputed masks straight into it. Masks hold coverage
+ * (0-3, from a radius r+0.5 disc) so color watches keep antialiased edges by
+ * blending in the 2-bit color space; B&W keeps the pixels at 2/3 coverage or
+ * more. Round displays only store each row's visible span, so every write is
+ * checked against that row's data bounds.
+ *
+ * The ring goes down in two passes, elapsed minutes then upcoming ones, so
+ * the ink is chosen once per pass rather than per dot. On B&W the ink isn't a
+ * color at all: DotInk is just "dim", which stamps a 50% checkerboard (the
+ * same trade the firmware makes for gray fills) where color watches blend.
+ * ------------------------------------------------------------------------- */
+static const uint8_t s_dotMask0[] = { 3 };
+static const uint8_t s_dotMask1[] = { 2, 3, 2,
+                                      3, 3, 3,
+                                      2, 3, 2 };
+static const uint8_t s_dotMask2[] = { 0, 2, 3, 2, 0,
+                                      2, 3, 3, 3, 2,
+                                      3, 3, 3, 3, 3,
+                                      2, 3, 3, 3, 2,
+                                      0, 2, 3, 2, 0 };
+static const uint8_t *const s_dotMasks[] = { s_dotMask0, s_dotMask1, s_dotMask2 };
+
+#if defined(PBL_COLOR)
+typedef GColor8 DotInk;
+
+static uint8_t blendChannel(uint8_t dst, uint8_t src, uint8_t coverage) {
+  return (dst * (3 - coverage) + src * coverage + 1) / 3;
+}
+#else
+typedef bool DotInk;   // true = dim
+#endif
+
+static void stampDot(GBitmap *fb, GPoint p, int radius, DotInk ink) {
+  if (radius < 0) {
+    radius = 0;
+  } else if (radius > DOT_SIZE_BOLD) {
+    radius = DOT_SIZE_BOLD;
+  }
+  const uint8_t *mask = s_dotMasks[radius];
+  int size = 2 * radius + 1;
+  int height = gbitmap_get_bounds(fb).size.h;
+
+  for (int my = 0; my < size; my++) {
+    int y = p.y - radius + my;
+    if (y < 0 || y >= height) {
+      continue;
+    }
+    GBitmapDataRowInfo row = gbitmap_get_data_row_info(fb, y);
+    for (int mx = 0; mx < size; mx++) {
+      int x = p.x - radius + mx;
+      uint8_t coverage = mask[my * size + mx];
+      if (coverage == 0 || x < row.min_x || x > row.max_x) {
+        continue;
+      }
+#if defined(PBL_COLOR)
+      GColor8 dst = (GColor8){ .argb = row.data[x] };
+      dst.r = blendChannel(dst.r, ink.r, coverage);
+      dst.g = blendChannel(dst.g, ink.g, coverage);
+      dst.b = blendChannel(dst.b, ink.b, coverage);
+      row.data[x] = dst.argb;
+#else
+      if (coverage >= 2) {
+        uint8_t bit = 1 << (x % 8);
+        if (!ink || ((x + y) & 1) == 0) {
+          row.data[x / 8] |= bit;
+        } else {
+          row.data[x / 8] &= ~bit;
+        }
+      }
+#endif
+    }
+  }
+}
+
+typedef enum {
+  RING_CIRCLES,   // graphics_fill_circle per dot: fallback and baseline
+  RING_DIRECT,    // masks stamped into the captured frame buffer
+  RING_SPOKES     // one graphics_draw_line per minute
+} RingStyle;
+
+// Spoke lines: a minute is one segment from its first dot's position to its
+// last, with round caps, so a 1-dot minute is still a dot. Width 2r+1 matches
+// a dot of radius r. A dot drawn a size smaller becomes a thinner stretch of
+// line: the whole spoke is laid down thin, then the thick stretch over it —
+// from dot 1 on hour marks, up to the last dot the battery still allows.
+static void drawSpokeLine(GContext *ctx, GPoint center, const RingGeometry *ring,
+                          int p, int numDots, bool hourMark, int thickDots) {
+  GPoint from = GPoint(center.x + ring->dots[p][0].x, center.y + ring->dots[p][0].y);
+  GPoint to = GPoint(center.x + ring->dots[p][numDots - 1].x,
+                     center.y + ring->dots[p][numDots - 1].y);
+  int thickFrom = hourMark ? 1 : 0;
+  int thickTo = (thickDots < numDots ? thickDots : numDots) - 1;
+
+  if (thickFrom > 0 || thickTo < numDots - 1) {
+    graphics_context_set_stroke_width(ctx, 2 * (s_dotSize - 1) + 1);
+    graphics_draw_line(ctx, from, to);
+  }
+  if (thickFrom <= thickTo) {
+    graphics_context_set_stroke_width(ctx, 2 * s_dotSize + 1);
+    graphics_draw_line(ctx,
+        GPoint(center.x + ring->dots[p][thickFrom].x, center.y + ring->dots[p][thickFrom].y),
+        GPoint(center.x + ring->dots[p][thickTo].x, center.y + ring->dots[p][thickTo].y));
+  }
+}
+
+// One pass of drawRing(): the spokes of minutes first..last, all in one ink.
+static void drawSpokes(GContext *ctx, GBitmap *fb, GPoint center, const RingGeometry *ring,
+                       int first, int last, bool elapsed, RingStyle style,
+                       GColor8 color, DotInk ink) {
+  // Hour marks and battery indication both work by drawing a dot a size
+  // smaller, so they only have a visible effect while bold dots are on.
+  bool hourMarks = config_get(PERSIST_KEY_BOLD_DOTS) && config_get(PERSIST_KEY_MINMARKS);
+  bool batteryInd = config_get(PERSIST_KEY_BOLD_DOTS) && config_get(PERSIST_KEY_BATTERY);
+  int thickDots = batteryInd ? s_batteryLevel / BATTERY_STEP_PER_DOT : RING_LEVELS;
+  if (style == RING_SPOKES) {
+    graphics_context_set_stroke_color(ctx, color);
+  } else if (fb == NULL) {
+    graphics_context_set_fill_color(ctx, color);
+  }
+
+  for (int m = first; m <= last; m++) {
+    int p = ringPos(m);
+    if (p >= s_sweepShown) {
+      continue;
+    }
+    int numDots = s_dotArray[m];
+    if (numDots == 0 && elapsed) {
+      numDots = 1;
+    }
+    if (numDots > RING_LEVELS) {
+      numDots = RING_LEVELS;
+    }
+    if (style == RING_SPOKES) {
+      if (numDots > 0) {
+        drawSpokeLine(ctx, center, ring, p, numDots, hourMarks && p % 5 == 0, thickDots);
+      }
+      continue;
+    }
+
+    for (int i = 0; i < numDots; i++) {
+      GPoint point = GPoint(center.x + ring->dots[p][i].x,
+                            center.y + ring->dots[p][i].y);
+      // Hour marks: the base dot at each clock-hour position (every 5 minutes
+      // = the 12 ticks) is drawn a size smaller than the bold dots.
+      int radius = s_dotSize;
+      if (hourMarks && p % 5 == 0 && i == 0) {
+        radius = s_dotSize - 1;
+      }
+      if (batteryInd && s_batteryLevel < (i + 1) * BATTERY_STEP_PER_DOT) {
+        radius = s_dotSize - 1;
+      }
+      if (fb != NULL) {
+        stampDot(fb, point, radius, ink);
+      } else {
+        graphics_fill_circle(ctx, point, radius);
+      }
+    }
+  }
+}
+
+// Ink for elapsed (main) or coming (dim) dots in the frame buffer.
+static DotInk dotInk(bool main) {
+#if defined(PBL_COLOR)
+  return main ? getDotMainColor() : getDotDarkColor();
+#else
+  return !main;
+#endif
+}
+
+// Ghost ticks for minutes first..last: a single dim pixel at the level each
+// minute typically reaches, only where this hour's spoke falls short of it,
+// so every upcoming minute shows its ghost. The table is the clock hour's, so
+// in the rolling window the minutes still showing the previous hour get none;
+// nor do positions the launch sweep hasn't revealed.
+static void drawGhosts(GContext *ctx, GBitmap *fb, GPoint center, const RingGeometry *ring,
+                       int first, int last, int lastMin) {
+  if (!config_get(PERSIST_KEY_GHOST) || !typicalHourCurrent()) {
+    return;
+  }
+  bool rolling = config_get(PERSIST_KEY_ROLLING);
+  int nowMin = (60 - s_ringRotation) % 60;
+  DotInk ink = dotInk(false);
+  if (fb == NULL) {
+    graphics_context_set_fill_color(ctx, getDotDarkColor());
+  }
+  for (int m = first; m <= last; m++) {
+    int p = ringPos(m);
+    if (p >= s_sweepShown || (rolling && m > nowMin)) {
+      continue;
+    }
+    int typical = typicalLevel(m);
+    // Upcoming minutes still hold last hour's spokes, so only an elapsed
+    // minute's live level can cover its ghost.
+    int numDots = 0;
+    if (m <= lastMin) {
+      numDots = s_dotArray[m] > 0 ? s_dotArray[m] : 1;
+    }
+    if (typical <= numDots) {
+      continue;
+    }
+    GPoint point = GPoint(center.x + ring->dots[p][typical - 1].x,
+                          center.y + ring->dots[p][typical - 1].y);
+    if (fb != NULL) {
+      stampDot(fb, point, 0, ink);
+    } else {
+      graphics_fill_circle(ctx, point, 0);
+    }
+  }
+}
+
+// Draws the spokes from s_dotArray in the given style: all 60, or as many as
+// the launch sweep has revealed. RING_DIRECT falls back to RING_CIRCLES if the
+// frame buffer can't be captured.
+static void drawRing(GContext *ctx, GPoint center, const RingGeometry *ring,
+                     int lastMin, RingStyle style) {
+  GColor8 mainColor = getDotMainColor();
+  GColor8 darkColor = getDotDarkColor();
+  DotInk mainInk = dotInk(true);
+  DotInk darkInk = dotInk(false);
+
+  // The canvas layer covers the whole screen, so its coordinates are the
+  // frame buffer's.
+  GBitmap *fb = (style == RING_DIRECT) ? graphics_capture_frame_buffer(ctx) : NULL;
+
+  drawSpokes(ctx, fb, center, ring, 0, lastMin, true, style, mainColor, mainInk);
+  drawSpokes(ctx, fb, center, ring, lastMin + 1, 59, false, style, darkColor, darkInk);
+
+  drawGhosts(ctx, fb, center, ring, 0, 59, lastMin);
+
+  if (fb != NULL) {
+    graphics_release_frame_buffer(ctx, fb);
+  }
+}
+
+// RING_BENCHMARK: draw the ring each way a number of times per frame and log
+// the total cost of each. The last pass is overdrawn by the real one.
+static void benchmarkRing(GContext *ctx, GPoint center, const RingGeometry *ring,
+                          int lastMin) {
+  uint32_t cost[3];
+  for (int style = RING_CIRCLES; style <= RING_SPOKES; style++) {
+    uint32_t start = timeMs();
+    for (int i = 0; i < RING_BENCHMARK_PASSES; i++) {
+      drawRing(ctx, center, ring, lastMin, (RingStyle)style);
+    }
+    cost[style] = timeMs() - start;
+  }
+
+  APP_LOG(APP_LOG_LEVEL_INFO, "ring x%d: fill_circle %lu ms, framebuffer %lu ms, spokes %lu ms",
+          RING_BENCHMARK_PASSES, (unsigned long)cost[RING_CIRCLES],
+          (unsigned long)cost[RING_DIRECT], (unsigned long)cost[RING_SPOKES]);
+}
+
+// The next hour's forecast as a thin arc just inside the ring, each 5-minute
+// step over the minutes it covers: colored by temperature, drawn thick where
+// rain is expected. Steps already over are skipped, so the arc shrinks toward
+// the present until the next refresh.
+static void drawForecastArc(GContext *ctx, GPoint center, int baseDist) {
+  if (!BUILD_WEATHER || s_forecastStart == 0) {
+    return;
+  }
+  time_t now = time(NULL);
+  int startMin = localtime(&s_forecastStart)->tm_min;
+  int r = baseDist - DOT_SPACING / 2 - 1;
+  GRect circle = GRect(center.x - r, center.y - r, 2 * r, 2 * r);
+
+  for (int k = 0; k < FORECAST_STEPS; k++) {
+    time_t stepStart = s_forecastStart + k * FORECAST_STEP_SECONDS;
+    time_t stepEnd = stepStart + FORECAST_STEP_SECONDS;
+    // Only the coming hour fits on the ring without wrapping onto the present.
+    if (stepEnd <= now || stepStart >= now + SECONDS_PER_HOUR - 60) {
+      continue;
+    }
+    int from = startMin + k * 5;
+    int to = from + 5;
+    if (stepStart < now) {
+      from += (now - stepStart) / 60;   // the current step starts at "now"
+    }
+    graphics_context_set_stroke_color(ctx, getWeatherColor(s_forecastTemp[k]));
+    graphics_context_set_stroke_width(ctx,
+        s_forecastPrecip[k] >= FORECAST_RAIN_THRESHOLD ? 3 : 1);
+    from += s_ringRotation;
+    to += s_ringRotation;
+    graphics_draw_arc(ctx, circle, GOvalScaleModeFitCircle,
+                      TRIG_MAX_ANGLE * from / 60, TRIG_MAX_ANGLE * to / 60);
+  }
+}
+
+static void startup_phase_handler(void *context);
+
+// Called at the end of every canvas draw; only does anything during launch.
+static void noteLaunchFrame() {
+  if (s_startupPhase == STARTUP_FIRST_FRAME) {
+    APP_LOG(APP_LOG_LEVEL_INFO, "time to first frame: %lu ms",
+            (unsigned long)(timeMs() - s_launchMs));
+    s_startupPhase = STARTUP_SUBSCRIBE;
+    app_timer_register(STARTUP_PHASE_DELAY_MS, startup_phase_handler, NULL);
+  } else if (s_ringCompletePending && s_sweepShown == 60) {
+    s_ringCompletePending = false;
+    APP_LOG(APP_LOG_LEVEL_INFO, "time to complete ring: %lu ms",
+            (unsigned long)(timeMs() - s_launchMs));
+  }
+}
+
+/* ---------------------------------------------------------------------------
+ * Seconds arc
+ *
+ * A thin arc inside the provider dots, swept once a minute. Each second is a
+ * seconds frame (see "Redraw modes") that draws only the arc segment since
+ * the last one; full frames draw it from 0. The face times every seconds
+ * frame and, every 60 of them, compares the average against the platform's
+ * budget from layout.json (LAYOUT_SECONDS_BUDGET_MS). Over budget, the arc
+ * steps every 5 seconds, then every 15. The timing covers this app's drawing
+ * only — the firmware's layer walk and display flush come on top.
+ * ------------------------------------------------------------------------- */
+static void drawSecondsArc(GContext *ctx, GPoint center, const RingGeometry *ring,
+                           int from, int to) {
+  if (to <= from) {
+    return;
+  }
+  int r = ring->baseDist - DOT_SPACING - 5;
+  graphics_context_set_stroke_color(ctx, getDotMainColor());
+  graphics_context_set_stroke_width(ctx, 1);
+  graphics_draw_arc(ctx, GRect(center.x - r, center.y - r, 2 * r, 2 * r),
+                    GOvalScaleModeFitCircle,
+                    TRIG_MAX_ANGLE * from / 60, TRIG_MAX_ANGLE * to / 60);
+}
+
+static void drawSecondsFrame(GContext *ctx, GPoint center) {
+  uint32_t start = timeMs();
+  drawSecondsArc(ctx, center, s_ring, s_secondsDrawn, s_secondsShown);
+  s_secondsDrawn = s_secondsShown;
+  s_secondsCostMs += timeMs() - start;
+
+  if (++s_secondsFrames == 60) {
+    APP_LOG(APP_LOG_LEVEL_INFO, "seconds arc: %lu ms / 60 frames (budget %d ms each, stride %d s)",
+            (unsigned long)s_secondsCostMs, LAYOUT_SECONDS_BUDGET_MS, s_secondsStride);
+    if (s_secondsCostMs > (uint32_t)LAYOUT_SECONDS_BUDGET_MS * 60 && s_secondsStride < 15) {
+      s_secondsStride = (s_secondsStride == 1) ? 5 : 15;
+    }
+    s_secondsCostMs = 0;
+    s_secondsFrames = 0;
+  }
+}
+
+/* ---------------------------------------------------------------------------
+ * Launch sweep
+ *
+ * Optional. Once the history backfill lands, the ring is cleared and filled
+ * clockwise from 12 o'clock by a short Animation instead of appearing in one
+ * repaint. Each animation update reveals the positions its progress has
+ * reached and asks for a partial frame (see "Redraw modes"), which stamps just
+ * those spokes and their ghost ticks over the previous frame; the providers
+ * and text were drawn by the full frame that started the sweep.
+ *
+ * Every sweep frame is timed against the platform's budget from layout.json
+ * (LAYOUT_SWEEP_BUDGET_MS). Time over budget is paid back by dropping the
+ * updates that follow, one budget's worth each, and the next frame drawn
+ * catches up on every spoke revealed meanwhile, so a slow watch takes the same
+ * time with fewer, fuller steps. Skipped entirely on a low battery.
+ * ------------------------------------------------------------------------- */
+#define SWEEP_DURATION_MS   600
+#define SWEEP_MIN_BATTERY   20    // percent; at or below, the ring just appears
+
+static Animation *s_sweep = NULL;
+static uint32_t s_sweepDebtMs = 0;
+static int s_sweepFrames = 0;
+static int s_sweepDropped = 0;
+
+static void drawSweepFrame(GContext *ctx, GPoint center) {
+  uint32_t start = timeMs();
+  RingStyle style = config_get(PERSIST_KEY_SPOKES) ? RING_SPOKES : RING_DIRECT;
+  GBitmap *fb = (style == RING_DIRECT) ? graphics_capture_frame_buffer(ctx) : NULL;
+  for (int p = s_sweepDrawn; p < s_sweepShown; p++) {
+    int m = (p - s_ringRotation + 60) % 60;
+    bool elapsed = m <= s_ringLastElapsed;
+    drawSpokes(ctx, fb, center, s_ring, m, m, elapsed, style,
+               elapsed ? getDotMainColor() : getDotDarkColor(), dotInk(elapsed));
+    drawGhosts(ctx, fb, center, s_ring, m, m, s_ringLastElapsed);
+  }
+  if (fb != NULL) {
+    graphics_release_frame_buffer(ctx, fb);
+  }
+  s_sweepDrawn = s_sweepShown;
+
+  uint32_t cost = timeMs() - start;
+  s_sweepFrames++;
+  if (cost > LAYOUT_SWEEP_BUDGET_MS) {
+    s_sweepDebtMs += cost - LAYOUT_SWEEP_BUDGET_MS;
+  }
+}
+
+static void sweep_update(Animation *animation, const AnimationProgress progress) {
+  int shown = (int)((int32_t)progress * 60 / ANIMATION_NORMALIZED_MAX);
+  if (shown > 60) {
+    shown = 60;
+  }
+  if (shown <= s_sweepShown) {
+    return;
+  }
+  if (s_sweepDebtMs > 0) {
+    s_sweepDebtMs -= (s_sweepDebtMs > LAYOUT_SWEEP_BUDGET_MS) ? LAYOUT_SWEEP_BUDGET_MS
+                                                              : s_sweepDebtMs;
+    s_sweepDropped++;
+    return;
+  }
+  s_sweepShown = shown;
+  markPartialDirty();
+}
+
+// Runs when the sweep finishes or is unscheduled. The sweep ends on a full
+// frame, so whatever is left of the ring shows and nothing drawn after it
+// leans on the partial frames' retained image.
+static void sweep_teardown(Animation *animation) {
+  s_sweep = NULL;
+  APP_LOG(APP_LOG_LEVEL_INFO, "launch sweep: %d frames, %d dropped (budget %d ms each)",
+          s_sweepFrames, s_sweepDropped, LAYOUT_SWEEP_BUDGET_MS);
+  s_sweepShown = 60;
+  markCanvasDirty();
+}
+
+static const AnimationImplementation s_sweepImpl = {
+  .update = sweep_update,
+  .teardown = sweep_teardown
+};
+
+// Called once the backfill is in. Without the sweep, the backfill's own full
+// frame shows the ring at once.
+static void startLaunchSweep() {
+  if (!config_get(PERSIST_KEY_SWEEP) || !s_inFocus || SCREENSHOT_RUN ||
+      s_batteryLevel <= SWEEP_MIN_BATTERY) {
+    return;
+  }
+  s_sweepShown = 0;
+  s_sweepDrawn = 0;
+  s_sweepDebtMs = 0;
+  s_sweepFrames = 0;
+  s_sweepDropped = 0;
+  markCanvasDirty();
+
+  s_sweep = animation_create();
+  animation_set_duration(s_sweep, SWEEP_DURATION_MS);
+  animation_set_curve(s_sweep, AnimationCurveEaseOut);
+  animation_set_implementation(s_sweep, &s_sweepImpl);
+  animation_schedule(s_sweep);
+}
+
+static void stopLaunchSweep() {
+  if (s_sweep != NULL) {
+    animation_unschedule(s_sweep);
+  }
+}
+
 static void draw_proc(Layer *layer, GContext *ctx) {
-  srand(time(NULL));  // For screenshots
+  uint32_t energyStart = energyBegin();
   GRect bounds = layer_get_bounds(layer);
   GPoint center = grect_center_point(&bounds);
+
+  if (s_partialFrame) {
+    if (s_sweepDrawn < s_sweepShown) {
+      drawSweepFrame(ctx, center);
+      noteLaunchFrame();
+    }
+    if (s_secondsDrawn < s_secondsShown) {
+      drawSecondsFrame(ctx, center);
+    }
+    s_partialFrame = false;
+    energyEnd(energyStart);
+    return;
+  }
+  s_fullPending = false;
+
+  ENERGY_COUNT(redraws);
+  srand(time(NULL));  // For screenshots
   
   int lastMin = 0;
   if (SCREENSHOT_RUN) {
@@ -967,122 +2939,66 @@ static void draw_proc(Layer *layer, GContext *ctx) {
     lastMin = s_last_time.minutes;  // For real
   }
 
-  // Base ring radius. On emery, the "Fit dots" option pulls the ring in so a
-  // full 5-dot minute clears the screen edge instead of being clipped.
-  int baseDist = DOT_DISTANCE;
-#if defined(PBL_PLATFORM_EMERY)
-  if (config_get(PERSIST_KEY_FITDOTS)) {
-    int halfMin = (bounds.size.w < bounds.size.h ? bounds.size.w : bounds.size.h) / 2;
-    int stackReach = 4 * DOT_SPACING + s_dotSize;  // outer edge beyond baseDist
-    int fit = halfMin - stackReach - 4;            // 4px breathing margin
-    if (fit > 0 && fit < baseDist) {
-      baseDist = fit;
+  // The current minute's spoke comes from the live step delta. Resolved before
+  // drawing so the ring itself is a pure function of s_dotArray. Until the
+  // startup chain has taken the step snapshot there's nothing to diff against.
+  for (int m = 0; m <= 59; m++) {
+    if ((m == lastMin && s_startupPhase > STARTUP_SUBSCRIBE) || SCREENSHOT_RUN) {
+      s_dotArray[m] = getNumDots();
     }
   }
-#endif
-
-  for (int m = 0; m <= 59; m++) {
-    GColor8 dotColor = (m <= lastMin) ? getDotMainColor() : getDotDarkColor();
-    graphics_context_set_fill_color(ctx, dotColor);
-
-    // Hour marks: with bold dots on, the base dot at each clock-hour position
-    // (every 5 minutes = the 12 ticks) is drawn a size smaller than the bold dots.
-    bool hourMark = config_get(PERSIST_KEY_BOLD_DOTS)
-                 && config_get(PERSIST_KEY_MINMARKS)
-                 && (m % 5 == 0);
 
-    // Like hour marks, battery indication works by drawing a dot a size
-    // smaller, so it only has a visible effect while bold dots are on.
-    bool batteryInd = config_get(PERSIST_KEY_BOLD_DOTS)
-                   && config_get(PERSIST_KEY_BATTERY);
-
-    int v = baseDist;
+  // The rolling window pins the current minute to the top, and every minute
+  // on the ring is from the trailing hour, so none of it is drawn dim.
+  int lastElapsed = lastMin;
+  s_ringRotation = 0;
+  if (config_get(PERSIST_KEY_ROLLING)) {
+    lastElapsed = 59;
+    s_ringRotation = (60 - lastMin) % 60;
+  }
+  s_ringLastElapsed = lastElapsed;
 
-    int numDots = s_dotArray[m];
-    
-    if (m == lastMin || SCREENSHOT_RUN) {
-      numDots = getNumDots();
-      s_dotArray[m] = numDots;
-    } else if (numDots == 0 && m <= lastMin) {
-      numDots = 1;
-    }
+  if (RING_BENCHMARK) {
+    benchmarkRing(ctx, center, s_ring, lastElapsed);
+  }
+  drawRing(ctx, center, s_ring, lastElapsed,
+           config_get(PERSIST_KEY_SPOKES) ? RING_SPOKES : RING_DIRECT);
+  s_sweepDrawn = s_sweepShown;
 
-    // For each dot
-    for (int i = 0; i < numDots; i++) {
+  if (config_get(PERSIST_KEY_WORKER)) {
+    drawSubMinuteTrack(ctx, center, s_ring, lastMin);
+  }
 
-      // Draw dot
-      for(int y = 0; y < 1; y++) {
-        for(int x = 0; x < 1; x++) {
-          GPoint point = (GPoint) {
-            .x = (int16_t)(sin_lookup(TRIG_MAX_ANGLE * m / 60) * (int32_t)(v) / TRIG_MAX_RATIO) + center.x,
-            .y = (int16_t)(-cos_lookup(TRIG_MAX_ANGLE * m / 60) * (int32_t)(v) / TRIG_MAX_RATIO) + center.y,
-          };
-          int radius = s_dotSize;
-          if (hourMark && i == 0) {
-            radius = s_dotSize - 1;
-          }
-          if (batteryInd && s_batteryLevel < (i + 1) * BATTERY_STEP_PER_DOT) {
-            radius = s_dotSize - 1;
-          }
-          graphics_fill_circle(ctx, GPoint(point.x + x, point.y + y), radius);
-        }
-      }
-      
-      // Draw next dot farther away
-      v += DOT_SPACING;
-    }
+  if (s_sparklineShown) {
+    drawSparkline(ctx, center, s_ring);
   }
   
-  if (config_get(PERSIST_KEY_WEATHER) && hasWeather) {
-    // Get weather "minute"
-    int m = weatherTemp % 60;
-    
-    // Get weather dot color
-    if (weatherTemp < 0) {
-      graphics_context_set_fill_color(ctx, GColorCeleste);
-    } else if (weatherTemp < 60) {
-      graphics_context_set_fill_color(ctx, GColorMediumAquamarine);
-    } else {
-      graphics_context_set_fill_color(ctx, GColorOrange);
-    }
-    
-    // Draw dot (just inside the ring, tracking the fit-adjusted radius)
-    int v = baseDist - DOT_SPACING - 1;
-    for(int y = 0; y < 1; y++) {
-      for(int x = 0; x < 1; x++) {
-        GPoint point = (GPoint) {
-          .x = (int16_t)(sin_lookup(TRIG_MAX_ANGLE * m / 60) * (int32_t)(v) / TRIG_MAX_RATIO) + center.x,
-          .y = (int16_t)(-cos_lookup(TRIG_MAX_ANGLE * m / 60) * (int32_t)(v) / TRIG_MAX_RATIO) + center.y,
-        };
-        graphics_fill_circle(ctx, GPoint(point.x + x, point.y + y), s_dotSize);
-      }
-    }
+  if (config_get(PERSIST_KEY_WEATHER) && config_get(PERSIST_KEY_FORECAST)) {
+    drawForecastArc(ctx, center, s_ring->baseDist);
   }
 
-  if (config_get(PERSIST_KEY_BPM)) {
-    // Heart rate as a dot, same positional idea as the weather dot: 72 bpm
-    // sits at the 12-minute mark. Zero means no sensor / no reading yet, so
-    // nothing draws on watches without heart-rate hardware.
-    int bpm = getCurrentBPM();
-    if (bpm > 0) {
-      int m = bpm % 60;
-      graphics_context_set_fill_color(ctx, PBL_IF_COLOR_ELSE(GColorFolly, GColorWhite));
-      int v = baseDist - DOT_SPACING - 1;
-      GPoint point = (GPoint) {
-        .x = (int16_t)(sin_lookup(TRIG_MAX_ANGLE * m / 60) * (int32_t)(v) / TRIG_MAX_RATIO) + center.x,
-        .y = (int16_t)(-cos_lookup(TRIG_MAX_ANGLE * m / 60) * (int32_t)(v) / TRIG_MAX_RATIO) + center.y,
-      };
-      graphics_fill_circle(ctx, point, s_dotSize);
-    }
+  drawProviders(ctx, center, s_ring);
+
+  if (config_get(PERSIST_KEY_SECONDS)) {
+    drawSecondsArc(ctx, center, s_ring, 0, s_secondsShown);
+    s_secondsDrawn = s_secondsShown;
   }
+
+  noteLaunchFrame();
+  energyEnd(energyStart);
 }
 
 static void battery_handler(BatteryChargeState state) {
+  uint32_t energyStart = energyBegin();
   s_batteryLevel = state.charge_percent;
-  layer_mark_dirty(s_canvas_layer);
+  markCanvasDirty();
+  energyEnd(energyStart);
 }
 
 static void health_handler(HealthEventType event, void *context) {
+  uint32_t energyStart = energyBegin();
+  ENERGY_COUNT(healthEvents);
+
   // Which type of event occured?
   switch(event) {
     case HealthEventSignificantUpdate:
@@ -1091,22 +3007,78 @@ static void health_handler(HealthEventType event, void *context) {
     case HealthEventMovementUpdate:
       APP_LOG(APP_LOG_LEVEL_INFO, "New HealthService HealthEventMovementUpdate event");
     
-      // Mark layer dirty so it updates
-      layer_mark_dirty(s_canvas_layer);
+      // Mark layer dirty so it updates — unless nobody can see it. The
+      // catch-up pass on regaining focus covers whatever was skipped.
+      if (s_inFocus) {
+        markCanvasDirty();
+      }
       break;
     case HealthEventSleepUpdate:
 //       APP_LOG(APP_LOG_LEVEL_INFO, "New HealthService HealthEventSleepUpdate event");
+      // Covered, no health queries: the refocus pass re-reads sleep.
+      if (!s_inFocus) {
+        break;
+      }
+      refreshSleep();
+      if (!s_awake) {
+        updateStepsLabel();
+      }
       break;
     case HealthEventMetricAlert:
-      // Not used by this watchface
+      // None registered; the wake switch runs off the minute tick.
       break;
     case HealthEventHeartRateUpdate:
-      // Refresh the BPM dot when a new reading lands.
-      if (config_get(PERSIST_KEY_BPM)) {
-        layer_mark_dirty(s_canvas_layer);
+      // Likewise the heart rate; the refocus pass re-runs the providers.
+      if (s_inFocus) {
+        runProviders(PROVIDER_EVENT_HEART_RATE, 0);
       }
       break;
   }
+
+  energyEnd(energyStart);
+}
+
+// ENERGY_PROFILE_WALKING: a steady walk, as steps and one movement event per
+// simulated minute, offset from the tick so it's a wakeup of its own.
+static void energy_walk_handler(void *context) {
+  s_energySimSteps += ENERGY_WALK_STEPS_PER_MIN;
+  health_handler(HealthEventMovementUpdate, NULL);
+  app_timer_register(1000, energy_walk_handler, NULL);
+}
+
+// Losing focus suspends on will_focus, as the modal starts to cover the face;
+// regaining it catches up on did_focus, once the face is fully visible again.
+static void focus_lost_handler(bool in_focus) {
+  if (!in_focus) {
+    s_inFocus = false;
+  }
+}
+
+static void focus_gained_handler(bool in_focus) {
+  if (!in_focus || s_inFocus) {
+    return;
+  }
+  s_inFocus = true;
+
+  // One catch-up pass: backfill the minutes spent covered, re-take the step
+  // snapshot so the live delta restarts from now, and redraw once. History
+  // lags by up to ~15 minutes, so also refetch at the next quarter hour.
+  fetchPastMinuteSteps();
+  refreshTypicalHour();
+  updateRollup();
+  runProviders(PROVIDER_EVENT_SETTINGS, 0);
+  // The weather refresh doesn't run while covered; ask now if one fell due.
+  if (config_get(PERSIST_KEY_WEATHER) && forecastStale()) {
+    requestWeather();
+  }
+  refreshSleep();
+  s_lastStepTotal = getTotalStepsToday();
+  s_lastMinSteps = 0;
+  s_loadedWithMissingData = true;
+  checkWakeCrossing(s_last_time.days);
+  update_time();
+  updateStepsLabel();
+  markCanvasDirty();
 }
 
 void comm_init() {
@@ -1120,6 +3092,108 @@ void comm_init() {
   app_message_open(app_message_inbox_size_maximum(), app_message_outbox_size_maximum());
 }
 
+static void restoreRingCache() {
+  for (int i = 0; i < 60; i++) {
+    s_dotArray[i] = 0;
+  }
+
+  RingCache cache;
+  if (persist_read_data(PERSIST_KEY_RING_CACHE, &cache, sizeof(cache)) != sizeof(cache)) {
+    return;
+  }
+  time_t now = time(NULL);
+  time_t nowMinute = now - now % 60;
+  time_t savedMinute = (time_t)cache.savedAt - cache.savedAt % 60;
+  int savedMin = localtime(&savedMinute)->tm_min;
+
+  // Keep an entry only if the minute it describes is still within the past
+  // hour the ring shows. The current minute always starts fresh.
+  for (int m = 0; m < 60; m++) {
+    time_t at = savedMinute - ((savedMin - m + 60) % 60) * 60;
+    if (at < nowMinute && nowMinute - at < SECONDS_PER_HOUR) {
+      s_dotArray[m] = cache.dots[m];
+    }
+  }
+}
+
+static void saveRingCache() {
+  RingCache cache = { .savedAt = (uint32_t)time(NULL) };
+  for (int m = 0; m < 60; m++) {
+    cache.dots[m] = (uint8_t)s_dotArray[m];
+  }
+  persist_write_data(PERSIST_KEY_RING_CACHE, &cache, sizeof(cache));
+  ENERGY_COUNT(persistWrites);
+}
+
+static void startup_phase_handler(void *context) {
+  switch (s_startupPhase) {
+    case STARTUP_FIRST_FRAME:
+    case STARTUP_DONE:
+      return;
+
+    case STARTUP_SUBSCRIBE:
+      // Snapshot today's steps before the tick handler or the live delta in
+      // draw_proc can diff against it.
+      s_lastStepTotal = getTotalStepsToday();
+      checkWakeCrossing(s_last_time.days);
+      subscribeTicks();
+      if (ENERGY_PROFILE && ENERGY_PROFILE_WALKING) {
+        app_timer_register(500, energy_walk_handler, NULL);
+      }
+#if defined(PBL_HEALTH)
+      if(!health_service_events_subscribe(health_handler, NULL)) {
+        APP_LOG(APP_LOG_LEVEL_ERROR, "Health not available!");
+      }
+#else
+      APP_LOG(APP_LOG_LEVEL_ERROR, "Health not available!");
+#endif
+      battery_state_service_subscribe(battery_handler);
+      app_focus_service_subscribe_handlers((AppFocusHandlers) {
+        .will_focus = focus_lost_handler,
+        .did_focus = focus_gained_handler
+      });
+      // Ask a running worker for its ring now; the answer usually lands before
+      // the history phase below, which then has nothing left to fetch.
+      app_worker_message_subscribe(worker_message_handler);
+      syncWorker();
+      syncMinuteExport();
+      syncSparkline();
+      runProviders(PROVIDER_EVENT_SETTINGS, 0);
+      if (app_worker_is_running()) {
+        AppWorkerMessage flush = { .data0 = 0 };
+        app_worker_send_message(WORKER_MSG_FLUSH, &flush);
+        ENERGY_COUNT(msgsSent);
+      }
+      break;
+
+    case STARTUP_HISTORY:
+      // The worker's ring, if it answered the flush in time, already covers
+      // the past hour.
+      if (!s_workerCoversHour) {
+        fetchPastMinuteSteps();
+      } else {
+        s_loadedWithMissingData = false;
+      }
+      refreshTypicalHour();
+      updateRollup();
+      s_ringCompletePending = true;
+      startLaunchSweep();
+      break;
+
+    case STARTUP_HANDSHAKE:
+      // PebbleKit JS may already have sent its ready message and had it
+      // dropped; the greeting asks it to send again. See "Handshake".
+      comm_init();
+      sendHello();
+      break;
+  }
+
+  s_startupPhase++;
+  if (s_startupPhase < STARTUP_DONE) {
+    app_timer_register(STARTUP_PHASE_DELAY_MS, startup_phase_handler, NULL);
+  }
+}
+
 
 
 
@@ -1129,18 +3203,22 @@ static void main_window_load(Window *window) {
   Layer *window_layer = window_get_root_layer(window);
   GRect bounds = layer_get_bounds(window_layer);
 
-  s_time_layer = text_layer_create(GRect(0, TIME_Y, bounds.size.w, 50));
-  text_layer_set_background_color(s_time_layer, GColorClear);
-  text_layer_set_text(s_time_layer, "00:00");
-  text_layer_set_text_alignment(s_time_layer, GTextAlignmentCenter);
-  layer_add_child(window_layer, text_layer_get_layer(s_time_layer));
+  // Paints the background color; see "Redraw modes".
+  s_bg_layer = layer_create(bounds);
+  layer_set_update_proc(s_bg_layer, bg_update_proc);
+  layer_add_child(window_layer, s_bg_layer);
+
+  // Placeholder frames; setLayerFonts() below moves them to the layout row.
+  s_time_layer = layer_create(GRect(0, 0, bounds.size.w, 50));
+  layer_set_update_proc(s_time_layer, time_update_proc);
+  layer_add_child(window_layer, s_time_layer);
 
-  s_step_count_layer = text_layer_create(GRect(0, STEP_Y, bounds.size.w, 40));
+  s_step_count_layer = text_layer_create(GRect(0, 0, bounds.size.w, 40));
   text_layer_set_text_alignment(s_step_count_layer, GTextAlignmentCenter);
   text_layer_set_background_color(s_step_count_layer, GColorClear);
   layer_add_child(window_layer, text_layer_get_layer(s_step_count_layer));
 
-  s_dayt_layer = text_layer_create(GRect(0, DATE_Y, bounds.size.w, 40));
+  s_dayt_layer = text_layer_create(GRect(0, 0, bounds.size.w, 40));
   text_layer_set_text_alignment(s_dayt_layer, GTextAlignmentCenter);
   text_layer_set_background_color(s_dayt_layer, GColorClear);
   layer_add_child(window_layer, text_layer_get_layer(s_dayt_layer));
@@ -1155,26 +3233,49 @@ static void main_window_load(Window *window) {
 }
 
 static void main_window_unload(Window *window) {
-  text_layer_destroy(s_time_layer);
+  layer_destroy(s_bg_layer);
+  layer_destroy(s_time_layer);
   text_layer_destroy(s_dayt_layer);
   text_layer_destroy(s_step_count_layer);
 
+  releaseClockAtlas();
   if (s_timeFont != NULL) {
     fonts_unload_custom_font(s_timeFont);
     s_timeFont = NULL;
   }
+  s_clockFont = NULL;
 
   layer_destroy(s_canvas_layer);
 }
 
 
 static void init() {
-  comm_init();
+  s_launchMs = timeMs();
   config_init();
+
+  // The first frame draws the ring cached at the last exit, so it has to be in
+  // place before the window is pushed.
+  loadAdaptiveScale();
+  loadRollup();
+  restoreRingCache();
+  time_t temp = time(NULL); 
+  struct tm *tick_time = localtime(&temp);
+  setLastTime(tick_time);
+
+  // Loaded with missing data?
+  if (tick_time->tm_min % 15 == 1) {
+    s_loadedWithMissingData = false;
+  } else {
+    s_loadedWithMissingData = true;
+  }
+
+  // Seed the charge level so the first draw is accurate; the subscription
+  // waits for the startup chain.
+  s_batteryLevel = battery_state_service_peek().charge_percent;
   
   // Create main Window element and assign to pointer
   s_main_window = window_create();
-  window_set_background_color(s_main_window, getBackgroundColor());
+  window_set_background_color(s_main_window, GColorClear);
 
   // Set handlers to manage the elements inside the Window
   window_set_window_handlers(s_main_window, (WindowHandlers) {
@@ -1187,45 +3288,18 @@ static void init() {
 
   // Make sure the time is displayed from the start
   update_time();
-  
-  // Loaded with missing data?
-  time_t temp = time(NULL); 
-  struct tm *tick_time = localtime(&temp);
-  
-  if (tick_time->tm_min % 15 == 1) {
-    s_loadedWithMissingData = false;
-  } else {
-    s_loadedWithMissingData = true;
-  }
-  
-  layer_mark_dirty(s_canvas_layer);
-
-  // Register with TickTimerService
-  tick_timer_service_subscribe(MINUTE_UNIT, tick_handler);  // For real
-  
-  for (int i = 0; i < 60; i++) {
-    s_dotArray[i] = 0;
-  }
-  
-  #if defined(PBL_HEALTH)
-  if(!health_service_events_subscribe(health_handler, NULL)) {
-    APP_LOG(APP_LOG_LEVEL_ERROR, "Health not available!");
-  }
-  #else
-  APP_LOG(APP_LOG_LEVEL_ERROR, "Health not available!");
-  #endif
-  
-  s_lastStepTotal = getTotalStepsToday();
-
-  // Seed the charge level before subscribing so the first draw is accurate.
-  // Safe here: the window is already pushed, so s_canvas_layer exists by now.
-  s_batteryLevel = battery_state_service_peek().charge_percent;
-  battery_state_service_subscribe(battery_handler);
 
-  fetchPastMinuteSteps();
+  // The rest of startup is chained from the first frame: see noteLaunchFrame().
 }
 
 static void deinit() {
+  stopLaunchSweep();
+  saveRingCache();
+  saveAdaptiveScale();
+  if (s_minuteLog != NULL) {
+    data_logging_finish(s_minuteLog);
+  }
+
   // Destroy Window
   window_destroy(s_main_window);
 }
@@ -52,6 +52,16 @@ module.exports = [
                      'Uses your location, and only while enabled.',
         defaultValue: false
       },
+      {
+        type: 'toggle',
+        messageKey: 'PERSIST_KEY_FORECAST',
+        label: 'Forecast arc',
+        description: 'With the weather dot on: the next hour\'s forecast as a ' +
+                     'thin arc just inside the ring over the coming minutes, ' +
+                     'colored by temperature and drawn thick where rain is ' +
+                     'expected.',
+        defaultValue: true
+      },
       {
         type: 'toggle',
         messageKey: 'PERSIST_KEY_BPM',
@@ -60,6 +70,53 @@ module.exports = [
                      'mark, same idea as the weather dot. Watches with a ' +
                      'heart-rate sensor only.',
         defaultValue: false
+      },
+      {
+        type: 'toggle',
+        messageKey: 'PERSIST_KEY_GHOST',
+        label: 'Typical hour',
+        description: 'A faint tick beyond each minute\'s spoke where your ' +
+                     'usual activity at this time of day (weekday or weekend ' +
+                     'average) would reach.',
+        defaultValue: false
+      },
+      {
+        type: 'toggle',
+        messageKey: 'PERSIST_KEY_SPARKLINE',
+        label: 'Flick for history',
+        description: 'Keeps a week of hourly step totals. Flick your wrist ' +
+                     'to see today\'s hours over yesterday\'s as a sparkline ' +
+                     'inside the ring for ten seconds.',
+        defaultValue: false
+      },
+      {
+        type: 'toggle',
+        messageKey: 'PERSIST_KEY_SECONDS',
+        label: 'Seconds arc',
+        description: 'Sweeps a thin arc inside the ring once a minute. ' +
+                     'Costs battery; on a busy watch it steps every 5 or ' +
+                     '15 seconds instead.',
+        defaultValue: false
+      },
+      {
+        type: 'toggle',
+        messageKey: 'PERSIST_KEY_WORKER',
+        label: 'Background recording',
+        description: 'Runs a small background worker that counts steps in ' +
+                     '10-second slices even while another app is open, so ' +
+                     'the ring never has gaps and the current minute shows ' +
+                     'when you moved. Replaces any other app\'s worker; ' +
+                     'costs some battery.',
+        defaultValue: false
+      },
+      {
+        type: 'toggle',
+        messageKey: 'PERSIST_KEY_EXPORT',
+        label: 'Export minutes',
+        description: 'Streams each finished minute\'s steps and dots to the ' +
+                     'phone over Pebble data logging, for your own analysis. ' +
+                     'Needs a companion app that collects the stream.',
+        defaultValue: false
       }
     ]
   },
@@ -83,6 +140,7 @@ module.exports = [
         type: 'select',
         messageKey: 'THEME',
         label: 'Color theme',
+        capabilities: ['COLOR'],
         defaultValue: 'orange',
         options: [
           { label: 'Orange', value: 'orange' },
@@ -99,6 +157,7 @@ module.exports = [
   },
   {
     type: 'section',
+    capabilities: ['COLOR'],
     items: [
       { type: 'heading', defaultValue: 'Custom Theme Colors' },
       {
@@ -172,6 +231,31 @@ module.exports = [
         description: 'Shown when using bold dots.',
         defaultValue: true
       },
+      {
+        type: 'toggle',
+        messageKey: 'PERSIST_KEY_SPOKES',
+        label: 'Spoke lines',
+        description: 'Draws each minute as one radial bar instead of ' +
+                     'stacked dots.',
+        defaultValue: false
+      },
+      {
+        type: 'toggle',
+        messageKey: 'PERSIST_KEY_ROLLING',
+        label: 'Rolling hour',
+        description: 'Shows the last 60 minutes with now at the top and ' +
+                     'earlier minutes running counter-clockwise, instead of ' +
+                     'following the clock hour.',
+        defaultValue: false
+      },
+      {
+        type: 'toggle',
+        messageKey: 'PERSIST_KEY_SWEEP',
+        label: 'Launch sweep',
+        description: 'Fills the ring clockwise when the face opens. ' +
+                     'Skipped when the battery is low.',
+        defaultValue: false
+      },
       {
         type: 'toggle',
         messageKey: 'PERSIST_KEY_FITDOTS',
@@ -182,6 +266,16 @@ module.exports = [
                      'left and right edges.',
         defaultValue: true
       },
+      {
+        type: 'toggle',
+        messageKey: 'PERSIST_KEY_ADAPTIVE',
+        label: 'Personal dot scale',
+        description: 'Scales each minute\'s dots to your own pace instead of ' +
+                     'a fixed 30 steps per dot: a full spoke means one of ' +
+                     'your busiest quarter of minutes. Learns from about the ' +
+                     'last week; uses the fixed scale until it has enough.',
+        defaultValue: false
+      },
       {
         type: 'toggle',
         messageKey: 'PERSIST_KEY_BATTERY',
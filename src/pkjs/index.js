@@ -1,17 +1,157 @@
+// For launch latency logging: how long until the handshake and first weather.
+var jsStartMs = Date.now();
+
 /* ---------------------------------------------------------------- config */
 
-// Vendored from pebble-clay 1.0.4 (MIT) — the npm package declares a platform
-// allowlist that predates flint/gabbro and ships only stub binaries, so we
-// carry its self-contained JS bundle directly. See vendor/LICENSE-pebble-clay.txt.
-var Clay = require('./vendor/pebble-clay');
-var clayConfig = require('./config');
 var messageKeys = require('message_keys');
-var clay = new Clay(clayConfig, null, { autoHandleEvents: false });
+
+// Clay and the page config are only needed once the settings page is opened,
+// so neither is loaded at startup: JS start does the handshake and weather
+// work only. The generated page is cached until a save changes what it shows.
+var clay = null;
+var clayUrl = null;
+
+// Bool settings the watch's build variant compiles out, as listed in its
+// greeting (KEY_LEFT_OUT). Their items are left off the page.
+var LEFT_OUT = 'leftOutSettings';
+
+// Select options and color items that only mean something with a given
+// bool setting built in.
+var OPTION_KEYS = {
+  CLOCK_FONT: { mont: 'PERSIST_KEY_FONT_MONT', roboto: 'PERSIST_KEY_FONT_ROBOTO' },
+  THEME: { custom: 'PERSIST_KEY_CLR_CUSTOM' }
+};
+var CUSTOM_COLOR_PREFIX = 'PERSIST_KEY_CUSTOM_';
+
+function loadLeftOut() {
+  try {
+    return JSON.parse(localStorage.getItem(LEFT_OUT)) || [];
+  } catch (ex) {
+    return [];
+  }
+}
+
+function saveLeftOut(keys) {
+  var json = JSON.stringify(keys);
+  if (json !== localStorage.getItem(LEFT_OUT)) {
+    localStorage.setItem(LEFT_OUT, json);
+    clay = null;
+    clayUrl = null;
+  }
+}
+
+// Returns a copy of `items` without what the watch's build leaves out.
+// Sections left with no settings are dropped whole.
+function builtItems(items, leftOut) {
+  function built(name) {
+    if (name.indexOf(CUSTOM_COLOR_PREFIX) === 0) {
+      name = 'PERSIST_KEY_CLR_CUSTOM';
+    }
+    return leftOut.indexOf(messageKeys[name]) < 0;
+  }
+  var result = [];
+  items.forEach(function(item) {
+    if (item.messageKey && messageKeys[item.messageKey] !== undefined &&
+        !built(item.messageKey)) {
+      return;
+    }
+    var copy = {};
+    Object.keys(item).forEach(function(k) {
+      copy[k] = item[k];
+    });
+    var optionKeys = OPTION_KEYS[item.messageKey];
+    if (optionKeys) {
+      copy.options = item.options.filter(function(o) {
+        return !optionKeys[o.value] || built(optionKeys[o.value]);
+      });
+      if (!copy.options.some(function(o) { return o.value === item.defaultValue; })) {
+        copy.defaultValue = copy.options[0].value;
+      }
+    }
+    if (item.type === 'section') {
+      copy.items = builtItems(item.items, leftOut);
+      if (!copy.items.some(function(i) { return i.messageKey; })) {
+        return;
+      }
+    }
+    result.push(copy);
+  });
+  return result;
+}
+
+function getClay() {
+  if (!clay) {
+    // Vendored from pebble-clay 1.0.4 (MIT) — the npm package declares a
+    // platform allowlist that predates flint/gabbro and ships only stub
+    // binaries, so we carry its self-contained JS bundle directly. See
+    // vendor/LICENSE-pebble-clay.txt.
+    var Clay = require('./vendor/pebble-clay');
+    clay = new Clay(builtItems(require('./config'), loadLeftOut()), null,
+                    { autoHandleEvents: false });
+  }
+  return clay;
+}
 
 var showWeather = 0;
 
+/* ------------------------------------------------------- settings sync */
+
+// Saves go to the watch as a single byte array (KEY_SETTINGS) holding only
+// the keys whose values differ from the last save the watch acknowledged.
+// Layout, decoded by applySettingsBlob() in main.c:
+//   [version][revision, uint16 BE] then [key][value] records, value width
+//   implied by the key.
+// The revision counts acknowledged saves; the watch stores it and compares it
+// with the one in our ready message to spot a reinstall on either side.
+var SETTINGS_BLOB_VERSION = 2;
+var ACKED_SETTINGS = 'ackedSettings';
+var SETTINGS_REV = 'settingsRev';
+
+function settingsRevision() {
+  return parseInt(localStorage.getItem(SETTINGS_REV), 10) || 0;
+}
+
+function settingWidth(key) {
+  if (key >= messageKeys.PERSIST_KEY_CUSTOM_BG &&
+      key <= messageKeys.PERSIST_KEY_CUSTOM_DATE) {
+    return 3;  // packed 0xRRGGBB
+  }
+  if (key === messageKeys.PERSIST_KEY_WAKE_THRESHOLD) {
+    return 2;
+  }
+  return 1;    // bools
+}
+
+function loadAckedSettings() {
+  try {
+    return JSON.parse(localStorage.getItem(ACKED_SETTINGS)) || {};
+  } catch (ex) {
+    return {};
+  }
+}
+
+// Returns the blob for every key in `dict` that differs from `acked`, or null
+// when nothing changed (or, with `always`, a blob with no records).
+function packChangedSettings(dict, acked, revision, always) {
+  var bytes = [SETTINGS_BLOB_VERSION, (revision >> 8) & 0xFF, revision & 0xFF];
+  Object.keys(dict).map(Number).sort(function(a, b) { return a - b; })
+    .forEach(function(key) {
+      if (acked[key] === dict[key]) {
+        return;
+      }
+      bytes.push(key);
+      for (var shift = 8 * (settingWidth(key) - 1); shift >= 0; shift -= 8) {
+        bytes.push((dict[key] >> shift) & 0xFF);
+      }
+    });
+  return (bytes.length > 3 || always) ? bytes : null;
+}
+
 Pebble.addEventListener('showConfiguration', function(e) {
-  Pebble.openURL(clay.generateUrl());
+  if (!clayUrl) {
+    clayUrl = getClay().generateUrl();
+  }
+  Pebble.openURL(clayUrl);
 });
 
 Pebble.addEventListener('webviewclosed', function(e) {
@@ -20,7 +160,9 @@ Pebble.addEventListener('webviewclosed', function(e) {
     return;
   }
 
-  var dict = clay.getSettings(e.response);
+  var dict = getClay().getSettings(e.response);
+  // Clay embeds the saved values in the page, so regenerate it next time.
+  clayUrl = null;
 
   // The watch stores the clock font as radio-style booleans (all false =
   // Bitham). Translate the page's single select and drop the virtual key.
@@ -31,17 +173,20 @@ Pebble.addEventListener('webviewclosed', function(e) {
   dict[messageKeys.PERSIST_KEY_FONT_LECO]   = (font === 'leco')   ? 1 : 0;
 
   // Same for the color theme presets (all false would mean B&W on-watch, but
-  // the page always sends exactly one preset true, or custom).
+  // the page always sends exactly one preset true, or custom). B&W watches
+  // have no theme select at all, and nothing to translate.
   var theme = dict[messageKeys.THEME];
   delete dict[messageKeys.THEME];
-  dict[messageKeys.PERSIST_KEY_CLR_BW]     = (theme === 'bw')     ? 1 : 0;
-  dict[messageKeys.PERSIST_KEY_CLR_ORANGE] = (theme === 'orange') ? 1 : 0;
-  dict[messageKeys.PERSIST_KEY_CLR_GREEN]  = (theme === 'green')  ? 1 : 0;
-  dict[messageKeys.PERSIST_KEY_CLR_BLUE]   = (theme === 'blue')   ? 1 : 0;
-  dict[messageKeys.PERSIST_KEY_CLR_PURPLE] = (theme === 'purple') ? 1 : 0;
-  dict[messageKeys.PERSIST_KEY_CLR_RED]    = (theme === 'red')    ? 1 : 0;
-  dict[messageKeys.PERSIST_KEY_CLR_TEAL]   = (theme === 'teal')   ? 1 : 0;
-  dict[messageKeys.PERSIST_KEY_CLR_CUSTOM] = (theme === 'custom') ? 1 : 0;
+  if (theme !== undefined) {
+    dict[messageKeys.PERSIST_KEY_CLR_BW]     = (theme === 'bw')     ? 1 : 0;
+    dict[messageKeys.PERSIST_KEY_CLR_ORANGE] = (theme === 'orange') ? 1 : 0;
+    dict[messageKeys.PERSIST_KEY_CLR_GREEN]  = (theme === 'green')  ? 1 : 0;
+    dict[messageKeys.PERSIST_KEY_CLR_BLUE]   = (theme === 'blue')   ? 1 : 0;
+    dict[messageKeys.PERSIST_KEY_CLR_PURPLE] = (theme === 'purple') ? 1 : 0;
+    dict[messageKeys.PERSIST_KEY_CLR_RED]    = (theme === 'red')    ? 1 : 0;
+    dict[messageKeys.PERSIST_KEY_CLR_TEAL]   = (theme === 'teal')   ? 1 : 0;
+    dict[messageKeys.PERSIST_KEY_CLR_CUSTOM] = (theme === 'custom') ? 1 : 0;
+  }
 
   // Custom theme colors must reach the watch as packed ints; depending on
   // Clay's color component internals they can surface as hex strings.
@@ -63,9 +208,22 @@ Pebble.addEventListener('webviewclosed', function(e) {
     }
   });
 
-  Pebble.sendAppMessage(dict,
+  var acked = loadAckedSettings();
+  var revision = settingsRevision() % 0xFFFF + 1;
+  var blob = packChangedSettings(dict, acked, revision, false);
+  if (!blob) {
+    console.log('Settings unchanged, nothing to send');
+    return;
+  }
+
+  Pebble.sendAppMessage({ 'KEY_SETTINGS': blob },
     function(e) {
-      console.log('Settings update successful!');
+      console.log('Settings update successful! (' + blob.length + ' bytes)');
+      Object.keys(dict).forEach(function(k) {
+        acked[k] = dict[k];
+      });
+      localStorage.setItem(ACKED_SETTINGS, JSON.stringify(acked));
+      localStorage.setItem(SETTINGS_REV, String(revision));
     },
     function(e) {
       console.log('Settings update failed: ' + JSON.stringify(e));
@@ -83,27 +241,86 @@ var xhrRequest = function (url, type, callback) {
   xhr.send();
 };
 
+// Forecast payload, decoded by applyForecastBlob() in main.c:
+//   [version][start: uint32 BE unix seconds][current temp: int8 °F][n]
+//   [n x temp: int8 °F][n x precipitation: uint8, tenths of mm/h]
+var FORECAST_BLOB_VERSION = 1;
+var FORECAST_STEPS = 12;          // 5-minute steps: the coming hour
+var FORECAST_STEP_SECONDS = 300;
+
+function clampByte(v, lo, hi) {
+  return Math.max(lo, Math.min(hi, Math.round(v)));
+}
+
+// Open-Meteo's 15-minute series resampled to 5-minute steps starting at `start`:
+// temperature interpolated at each step's midpoint, precipitation taken from
+// the quarter hour containing the step (its value is the preceding 15 minutes'
+// sum, in mm).
+function packForecast(json, start) {
+  var q = json.minutely_15;
+  var bytes = [FORECAST_BLOB_VERSION,
+               (start >>> 24) & 0xFF, (start >>> 16) & 0xFF,
+               (start >>> 8) & 0xFF, start & 0xFF,
+               clampByte(json.current.temperature_2m, -128, 127) & 0xFF,
+               FORECAST_STEPS];
+  var temps = [];
+  var precip = [];
+
+  for (var k = 0; k < FORECAST_STEPS; k++) {
+    var t = start + k * FORECAST_STEP_SECONDS;
+    var mid = t + FORECAST_STEP_SECONDS / 2;
+
+    var i = 1;
+    while (i < q.time.length - 1 && q.time[i] < mid) {
+      i++;
+    }
+    var t0 = q.time[i - 1], t1 = q.time[i];
+    var f = Math.max(0, Math.min(1, (mid - t0) / (t1 - t0)));
+    var temp = q.temperature_2m[i - 1] + f * (q.temperature_2m[i] - q.temperature_2m[i - 1]);
+    temps.push(clampByte(temp, -128, 127) & 0xFF);
+
+    var mm = 0;
+    for (var j = 0; j < q.time.length; j++) {
+      if (q.time[j] - 900 <= t && t < q.time[j]) {
+        mm = q.precipitation[j] || 0;
+        break;
+      }
+    }
+    precip.push(clampByte(mm * 4 * 10, 0, 255));   // mm per 15 min -> 0.1 mm/h
+  }
+  return bytes.concat(temps, precip);
+}
+
 function locationSuccess(pos) {
-  // Open-Meteo: free, no API key, HTTPS, and returns Fahrenheit directly.
+  // Open-Meteo: free, no API key, HTTPS, and returns Fahrenheit directly. One
+  // request covers the current reading and the next 90 minutes in quarter
+  // hours, enough to resample the coming hour.
   var url = "https://api.open-meteo.com/v1/forecast?latitude=" +
       pos.coords.latitude + "&longitude=" + pos.coords.longitude +
-      "&current=temperature_2m&temperature_unit=fahrenheit";
+      "&current=temperature_2m&minutely_15=temperature_2m,precipitation" +
+      "&forecast_minutely_15=6&timeformat=unixtime&temperature_unit=fahrenheit";
 
   xhrRequest(url, 'GET',
     function(responseText) {
       var json = JSON.parse(responseText);
 
-      if (!json || !json.current || typeof json.current.temperature_2m !== 'number') {
+      if (!json || !json.current || typeof json.current.temperature_2m !== 'number' ||
+          !json.minutely_15 || !json.minutely_15.time || json.minutely_15.time.length < 2) {
         console.log("No weather data in response: " + responseText);
         return;
       }
 
-      var temperature = Math.round(json.current.temperature_2m);
-      console.log("Temperature is " + temperature);
+      var now = Math.floor(Date.now() / 1000);
+      var start = now - now % FORECAST_STEP_SECONDS;
+      var blob = packForecast(json, start);
+      console.log("Temperature is " + Math.round(json.current.temperature_2m) +
+                  ", forecast " + blob.length + " bytes");
+      localStorage.setItem(CACHED_FORECAST, JSON.stringify({ start: start, blob: blob }));
 
-      Pebble.sendAppMessage({ "KEY_TEMPERATURE": temperature },
+      Pebble.sendAppMessage({ "KEY_FORECAST": blob },
         function(e) {
-          console.log("Weather info sent to Pebble successfully!");
+          console.log("Weather info sent to Pebble successfully! (" +
+                      (Date.now() - jsStartMs) + " ms after JS start)");
         },
         function(e) {
           console.log("Error sending weather info to Pebble!");
@@ -117,6 +334,26 @@ function locationError(err) {
   console.log("Error requesting location!");
 }
 
+// The last forecast fetched, handed to the watch in the ready message so the
+// weather dot shows before a fresh fetch finishes. Only while it still covers
+// part of the coming hour, and only if weather is on in the saved settings.
+var CACHED_FORECAST = 'cachedForecast';
+
+function cachedForecast() {
+  if (!loadAckedSettings()[messageKeys.PERSIST_KEY_WEATHER]) {
+    return null;
+  }
+  try {
+    var cached = JSON.parse(localStorage.getItem(CACHED_FORECAST));
+    var now = Math.floor(Date.now() / 1000);
+    if (cached && cached.start + FORECAST_STEPS * FORECAST_STEP_SECONDS > now) {
+      return cached.blob;
+    }
+  } catch (ex) {
+  }
+  return null;
+}
+
 function getWeather() {
   if (showWeather == 1) {
     console.log("getting weather");
@@ -124,24 +361,75 @@ function getWeather() {
     navigator.geolocation.getCurrentPosition(
       locationSuccess,
       locationError,
-      {timeout: 15000, maximumAge: 60000}
+      // Weather doesn't need a fresh fix: a position from the last half hour
+      // is returned immediately instead of waiting on the GPS at launch.
+      {timeout: 15000, maximumAge: 30 * 60 * 1000}
     );
   }
 }
 
-// Listen for when the watchface is opened
+/* -------------------------------------------------------------- handshake */
+
+// One round trip at launch (see "Handshake" in main.c): our ready message
+// carries the settings revision and any cached forecast; the watch answers
+// only if it wants fresh weather or a settings resend. If it isn't listening
+// yet the send fails, and its greeting (KEY_JSREADY from the watch) asks again.
+// A greeting that lands while our send is still waiting on its NACK is held in
+// greetPending and answered once that send fails.
+var readyState = 'unsent';   // 'unsent' | 'sending' | 'sent'
+var greetPending = false;
+
+function sendReady() {
+  if (readyState === 'sending') {
+    greetPending = true;
+    return;
+  }
+  if (readyState !== 'unsent') {
+    return;
+  }
+  readyState = 'sending';
+  greetPending = false;
+  var msg = { "KEY_JSREADY": settingsRevision() };
+  var forecast = cachedForecast();
+  if (forecast) {
+    msg.KEY_FORECAST = forecast;
+  }
+  Pebble.sendAppMessage(msg,
+    function(e) {
+      readyState = 'sent';
+      greetPending = false;
+      console.log("Ready sent" + (forecast ? " with cached forecast" : "") +
+                  " (" + (Date.now() - jsStartMs) + " ms after JS start)");
+    },
+    function(e) {
+      readyState = 'unsent';
+      if (greetPending) {
+        console.log("Ready not delivered; the watch has greeted since, resending");
+        sendReady();
+        return;
+      }
+      console.log("Ready not delivered; waiting for the watch's greeting");
+    }
+  );
+}
+
+// The watch's revision disagreed with ours: send every acknowledged value
+// under our revision, even none, so the two agree from here on.
+function resendSettings() {
+  var blob = packChangedSettings(loadAckedSettings(), {}, settingsRevision(), true);
+  Pebble.sendAppMessage({ 'KEY_SETTINGS': blob },
+    function(e) {
+      console.log('Settings resent (' + blob.length + ' bytes)');
+    },
+    function(e) {
+      console.log('Settings resend failed: ' + JSON.stringify(e));
+    });
+}
+
 Pebble.addEventListener('ready',
   function(e) {
-    console.log("PebbleKit JS ready!");
-
-    Pebble.sendAppMessage({ "KEY_JSREADY": 1 },
-      function(e) {
-        console.log("JS Ready info sent to Pebble successfully!");
-      },
-      function(e) {
-        console.log("Error sending JS Ready info to Pebble!");
-      }
-    );
+    console.log("PebbleKit JS ready! (" + (Date.now() - jsStartMs) + " ms)");
+    sendReady();
   }
 );
 
@@ -150,14 +438,19 @@ Pebble.addEventListener('appmessage',
   function(e) {
     console.log('AppMessage received! Received message: ' + JSON.stringify(e.payload));
 
-    if (e.payload.PERSIST_KEY_WEATHER) {
-      showWeather = e.payload.PERSIST_KEY_WEATHER;
+    if (e.payload.KEY_JSREADY) {
+      saveLeftOut(e.payload.KEY_LEFT_OUT || []);
+      sendReady();
+    }
+    if (e.payload.KEY_SETTINGS) {
+      resendSettings();
     }
-    console.log("showWeather " + showWeather);
 
-    // Fetch on any weather signal: the initial handshake AND the watch's
-    // 30-minute refresh both land here. getWeather() guards on showWeather.
-    if (showWeather) {
+    // The watch only sends this when it wants weather: at the handshake, on
+    // its 30-minute refresh, or when the setting is turned on.
+    // getWeather() guards on showWeather.
+    if (e.payload.PERSIST_KEY_WEATHER) {
+      showWeather = e.payload.PERSIST_KEY_WEATHER;
       getWeather();
     }
   }
@@ -0,0 +1,233 @@
+#!/usr/bin/env python
+"""Compile src/c/layout.json into one platform's layout_tables.auto.h.
+
+Called from wscript once per target platform; can also be run by hand:
+
+    python tools/gen_layout.py emery src/c/layout.json /tmp/layout_tables.auto.h
+
+The clock font candidates come from package.json: every bundled font resource
+named <prefix>_<L|B>_<size> that targets the platform, where the prefix is the
+font's entry in layout.json's 'resourcePrefix'. The package is looked up next
+to src/ unless given as a fourth argument.
+
+--system-fonts is for build variants that leave the bundled fonts out: the
+bundled rows become copies of Bitham's, so no RESOURCE_ID_FONT_* is named,
+and there are no candidates to measure.
+
+The output holds only static const data. The types it fills in (FontLayout,
+FontCandidate, SecondaryFonts, RingGeometry) are declared in main.c just above
+the #include.
+"""
+
+from __future__ import print_function
+
+import json
+import math
+import os
+import re
+import sys
+import zlib
+
+# ClockFont order in main.c.
+FONTS = ['bitham', 'roboto', 'mont', 'leco']
+
+TRIG_MAX_RATIO = 0xffff
+TRIG_MAX_ANGLE = 0x10000
+
+
+def _trunc_div(a, b):
+    # C integer division, which truncates toward zero.
+    q = abs(a) // abs(b)
+    return q if (a >= 0) == (b > 0) else -q
+
+
+def _lookup(fn, angle):
+    return int(round(fn(2 * math.pi * angle / TRIG_MAX_ANGLE) * TRIG_MAX_RATIO))
+
+
+def _offset(minute, radius):
+    # Same arithmetic the face used at runtime: sin/cos_lookup of the minute
+    # angle, scaled by the radius with truncating integer division.
+    angle = TRIG_MAX_ANGLE * minute // 60
+    x = _trunc_div(_lookup(math.sin, angle) * radius, TRIG_MAX_RATIO)
+    y = _trunc_div(-_lookup(math.cos, angle) * radius, TRIG_MAX_RATIO)
+    return x, y
+
+
+def _platform(desc, name):
+    plat = desc['platforms'][name]
+    while 'like' in plat:
+        plat = desc['platforms'][plat['like']]
+    return plat
+
+
+def _font_row(row, fit):
+    if fit:
+        merged = dict(row)
+        merged.pop('overflow', None)
+        merged.update(row.get('fit', {}))
+        if 'system' in row.get('fit', {}):
+            merged.pop('resource', None)
+        if 'resource' in row.get('fit', {}):
+            merged.pop('system', None)
+        row = merged
+    tune = row.get('tune', [0, 0, 0])
+    if 'system' in row:
+        resource = '{ 0, 0 }'
+        system = '{ %s, %s }' % tuple(row['system'])
+    else:
+        resource = '{ %s, %s }' % tuple(row['resource'])
+        system = '{ NULL, NULL }'
+    auto_fit = 'resource' in row and not row.get('overflow', False)
+    return '{ %d, %d, %d, %d, %s, %s, %s }' % (
+        row['time'] + tune[0], row['step'] + tune[1], row['date'] + tune[2],
+        row['h'], resource, system, 'true' if auto_fit else 'false')
+
+
+def _candidates(desc, package, platform):
+    # {font: [(h, light, bold)]}, largest first.
+    sizes = {}
+    for res in package['pebble']['resources']['media']:
+        if res.get('type') != 'font' or platform not in res.get('targetPlatforms', [platform]):
+            continue
+        for font, prefix in desc['resourcePrefix'].items():
+            m = re.match(r'^%s_([LB])_(\d+)$' % re.escape(prefix), res['name'])
+            if m:
+                sizes.setdefault(font, {}).setdefault(int(m.group(2)), {})[m.group(1)] = res['name']
+    out = {}
+    for font, by_h in sizes.items():
+        out[font] = [(h, 'RESOURCE_ID_' + w['L'], 'RESOURCE_ID_' + w['B'])
+                     for h, w in sorted(by_h.items(), reverse=True) if 'L' in w and 'B' in w]
+    return out
+
+
+def bundled_font_prefixes(src):
+    """Resource name prefixes of the bundled clock fonts, e.g. 'FONT_TIME_'."""
+    with open(src) as f:
+        desc = json.load(f)
+    return tuple(prefix + '_' for prefix in sorted(desc['resourcePrefix'].values()))
+
+
+def _ring_dist(desc, plat, fit, bold):
+    if fit and plat.get('fitRing'):
+        half = min(plat['screen']) // 2
+        reach = (desc['ringLevels'] - 1) * desc['dotSpacing'] + desc['dotSize'][bold]
+        dist = half - reach - desc['fitMargin']
+        if 0 < dist < plat['ring']:
+            return dist
+    return plat['ring']
+
+
+def _ring(desc, dist):
+    spacing = desc['dotSpacing']
+    inner = [_offset(m, dist - spacing - 1) for m in range(60)]
+    lines = ['  { %d,' % dist]
+    lines.append('    { ' + ', '.join('{ %d, %d }' % p for p in inner) + ' },')
+    lines.append('    {')
+    for m in range(60):
+        dots = [_offset(m, dist + i * spacing) for i in range(desc['ringLevels'])]
+        lines.append('      { ' + ', '.join('{ %d, %d }' % p for p in dots) + ' },')
+    lines.append('    }')
+    lines.append('  },')
+    return lines
+
+
+def generate(platform, src, dst, package_path=None, bundled_fonts=True):
+    with open(src) as f:
+        desc = json.load(f)
+    plat = _platform(desc, platform)
+    if package_path is None:
+        package_path = os.path.join(os.path.dirname(os.path.abspath(src)), '..', '..', 'package.json')
+    with open(package_path) as f:
+        package = json.load(f)
+    candidates = _candidates(desc, package, platform) if bundled_fonts else {}
+    fonts = dict(plat['fonts'])
+    if not bundled_fonts:
+        for name in desc['resourcePrefix']:
+            fonts[name] = fonts['bitham']
+
+    out = []
+    out.append('// Generated by tools/gen_layout.py from src/c/layout.json for %s.' % platform)
+    out.append('// Do not edit; change the descriptor instead.')
+    out.append('#pragma once')
+    out.append('')
+    out.append('#define LAYOUT_TABLE_VERSION %d' % desc['version'])
+    out.append('#define LAYOUT_SECONDS_BUDGET_MS %d' % plat['secondsBudgetMs'])
+    out.append('#define LAYOUT_SWEEP_BUDGET_MS %d' % plat['sweepBudgetMs'])
+    out.append('#define LAYOUT_PLATFORM_ID 0x%04x' % (zlib.crc32(platform.encode('ascii')) & 0xffff))
+    out.append('')
+    out.append('#if DOT_SPACING != %d || RING_LEVELS != %d' % (desc['dotSpacing'], desc['ringLevels']))
+    out.append('#error "layout.json dotSpacing/ringLevels disagree with main.c"')
+    out.append('#endif')
+    out.append('')
+
+    out.append('// [fit][ClockFont]')
+    out.append('static const FontLayout LAYOUT_FONTS[2][%d] = {' % len(FONTS))
+    for fit in (False, True):
+        out.append('  {')
+        for name in FONTS:
+            out.append('    %s,  // %s' % (_font_row(fonts[name], fit), name))
+        out.append('  },')
+    out.append('};')
+    out.append('')
+
+    longest = max([len(c) for c in candidates.values()] + [0]) + 1
+    out.append('// [ClockFont], largest first; h == 0 ends each list.')
+    out.append('#define LAYOUT_MAX_CANDIDATES %d' % longest)
+    out.append('static const FontCandidate LAYOUT_FONT_CANDIDATES[%d][LAYOUT_MAX_CANDIDATES] = {' % len(FONTS))
+    for name in FONTS:
+        row = ['{ %d, { %s, %s } }' % c for c in candidates.get(name, [])]
+        row.append('{ 0, { 0, 0 } }')
+        out.append('  { %s },  // %s' % (', '.join(row), name))
+    out.append('};')
+    out.append('')
+
+    zoom = plat['secondary']
+    fit = plat.get('fitSecondary', zoom)
+    out.append('// [fit]')
+    out.append('static const SecondaryFonts LAYOUT_SECONDARY[2] = {')
+    out.append('  { { %s, %s } },' % tuple(zoom))
+    out.append('  { { %s, %s } },' % tuple(fit))
+    out.append('};')
+    out.append('')
+
+    dists = []
+    index = []
+    for fit in (False, True):
+        row = []
+        for bold in (0, 1):
+            dist = _ring_dist(desc, plat, fit, bold)
+            if dist not in dists:
+                dists.append(dist)
+            row.append(dists.index(dist))
+        index.append(row)
+    out.append('// [fit][bold dots] -> LAYOUT_RINGS')
+    out.append('static const uint8_t LAYOUT_RING_INDEX[2][2] = {')
+    for row in index:
+        out.append('  { %d, %d },' % tuple(row))
+    out.append('};')
+    out.append('')
+    out.append('static const RingGeometry LAYOUT_RINGS[%d] = {' % len(dists))
+    for dist in dists:
+        out.extend(_ring(desc, dist))
+    out.append('};')
+
+    with open(dst, 'w') as f:
+        f.write('\n'.join(out) + '\n')
+
+
+def waf_rule(platform, bundled_fonts=True):
+    # Inputs: layout.json, package.json, this script.
+    def rule(task):
+        generate(platform, task.inputs[0].abspath(), task.outputs[0].abspath(),
+                 task.inputs[1].abspath(), bundled_fonts)
+    return rule
+
+
+if __name__ == '__main__':
+    args = sys.argv[1:]
+    bundled = '--system-fonts' not in args
+    args = [a for a in args if a != '--system-fonts']
+    if len(args) not in (3, 4):
+        sys.exit('usage: gen_layout.py [--system-fonts] <platform> <layout.json> <out.h> [package.json]')
+    generate(*args, bundled_fonts=bundled)
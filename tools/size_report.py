@@ -0,0 +1,88 @@
+#!/usr/bin/env python
+"""Per-platform size report for one build variant.
+
+wscript registers post_fun() after the bundle, so every build ends with one
+row per platform under
+
+    platform     .text   .data    .bss   res pack   RAM used   heap left
+
+.text/.data/.bss come from the toolchain's `size` on pebble-app.elf.
+A Pebble app image is loaded into the app's RAM whole, so RAM used is the
+sum of all three and heap left is the platform's app RAM minus that, which
+is the same accounting the SDK's own memory summary uses. 'res pack' is
+app_resources.pbpack, which stays in flash and is read on demand.
+
+The table is also written to build/sizes-<variant>.txt so two variants can be
+diffed.
+"""
+
+from __future__ import print_function
+
+import os
+import subprocess
+
+# App RAM per platform, in bytes.
+APP_RAM = {
+    'aplite': 24 * 1024,
+    'basalt': 64 * 1024,
+    'chalk': 64 * 1024,
+    'diorite': 64 * 1024,
+    'emery': 128 * 1024,
+    'flint': 64 * 1024,
+    'gabbro': 128 * 1024,
+}
+
+
+def _size_tool(env):
+    # arm-none-eabi-gcc -> arm-none-eabi-size, wherever the SDK put it.
+    cc = env.CC[0] if isinstance(env.CC, list) else env.CC
+    if cc.endswith('gcc'):
+        return cc[:-3] + 'size'
+    return 'arm-none-eabi-size'
+
+
+def _elf_sizes(tool, elf):
+    # Berkeley format: "text data bss dec hex filename".
+    out = subprocess.check_output([tool, elf]).decode('ascii', 'replace')
+    fields = out.splitlines()[1].split()
+    return int(fields[0]), int(fields[1]), int(fields[2])
+
+
+def _row(platform, text, data, bss, pack):
+    used = text + data + bss
+    ram = APP_RAM.get(platform)
+    return '%-10s %7d %7d %7d %10s %10d %11s' % (
+        platform, text, data, bss, '-' if pack is None else pack, used,
+        '-' if ram is None else ram - used)
+
+
+def report(bld, variant, binaries):
+    lines = ['ActiveHour %s build' % variant,
+             '%-10s %7s %7s %7s %10s %10s %11s' % (
+                 'platform', '.text', '.data', '.bss', 'res pack', 'RAM used', 'heap left')]
+    root = bld.path.get_bld()
+    for binary in binaries:
+        platform = binary['platform']
+        env = bld.all_envs[platform]
+        elf = root.make_node(binary['app_elf']).abspath()
+        if not os.path.exists(elf):
+            continue
+        try:
+            text, data, bss = _elf_sizes(_size_tool(env), elf)
+        except (OSError, subprocess.CalledProcessError, IndexError, ValueError):
+            lines.append('%-10s (size unavailable)' % platform)
+            continue
+        pack_path = root.make_node('%s/app_resources.pbpack' % env.BUILD_DIR).abspath()
+        pack = os.path.getsize(pack_path) if os.path.exists(pack_path) else None
+        lines.append(_row(platform, text, data, bss, pack))
+
+    text = '\n'.join(lines) + '\n'
+    print(text, end='')
+    with open(root.make_node('sizes-%s.txt' % variant).abspath(), 'w') as f:
+        f.write(text)
+
+
+def post_fun(variant, binaries):
+    def run(bld):
+        report(bld, variant, binaries)
+    return run
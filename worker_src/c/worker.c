@@ -0,0 +1,123 @@
+#include <pebble_worker.h>
+#include "../../src/c/activity_ring.h"
+
+// Background step recorder. Every 10 seconds, on the bucket boundary, it
+// diffs today's step total into the bucket that just closed, keeps the last
+// hour in RAM, tells the face (if it's running) and persists the ring every
+// few minutes, on request, and on exit. See src/c/activity_ring.h.
+
+// Buckets between routine persists: five minutes' worth.
+#define PERSIST_EVERY_BUCKETS 30
+
+static uint8_t s_ring[ACTIVITY_RING_BUCKETS];
+static uint32_t s_newest = 0;
+static int32_t s_lastTotal = 0;
+static int s_sinceSave = 0;
+
+// The bucket underway at startup only saw part of its steps.
+static bool s_primed = false;
+
+static void persistRing() {
+  persist_write_data(PERSIST_KEY_ACTIVITY_HEAD, &s_newest, sizeof(s_newest));
+  persist_write_data(PERSIST_KEY_ACTIVITY_RING_A, s_ring, ACTIVITY_RING_HALF);
+  persist_write_data(PERSIST_KEY_ACTIVITY_RING_B, s_ring + ACTIVITY_RING_HALF,
+                     ACTIVITY_RING_HALF);
+  s_sinceSave = 0;
+}
+
+static void loadRing() {
+  memset(s_ring, ACTIVITY_BUCKET_UNKNOWN, sizeof(s_ring));
+  if (persist_read_data(PERSIST_KEY_ACTIVITY_HEAD, &s_newest, sizeof(s_newest)) != sizeof(s_newest) ||
+      persist_read_data(PERSIST_KEY_ACTIVITY_RING_A, s_ring, ACTIVITY_RING_HALF) != ACTIVITY_RING_HALF ||
+      persist_read_data(PERSIST_KEY_ACTIVITY_RING_B, s_ring + ACTIVITY_RING_HALF,
+                        ACTIVITY_RING_HALF) != ACTIVITY_RING_HALF) {
+    memset(s_ring, ACTIVITY_BUCKET_UNKNOWN, sizeof(s_ring));
+    s_newest = 0;
+  }
+}
+
+static int32_t totalStepsToday() {
+  HealthServiceAccessibilityMask mask = health_service_metric_accessible(
+      HealthMetricStepCount, time_start_of_today(), time(NULL));
+  if (mask & HealthServiceAccessibilityMaskAvailable) {
+    return (int32_t)health_service_sum_today(HealthMetricStepCount);
+  }
+  return 0;
+}
+
+static void bucket_timer_handler(void *context);
+
+// Fire just past the next 10-second boundary.
+static void scheduleNextBucket() {
+  time_t s;
+  uint16_t ms;
+  time_ms(&s, &ms);
+  uint32_t wait = (ACTIVITY_BUCKET_SECONDS - s % ACTIVITY_BUCKET_SECONDS) * 1000 - ms + 50;
+  app_timer_register(wait, bucket_timer_handler, NULL);
+}
+
+static void bucket_timer_handler(void *context) {
+  uint32_t bucket = (uint32_t)time(NULL) / ACTIVITY_BUCKET_SECONDS - 1;
+  int32_t total = totalStepsToday();
+  int32_t steps = total - s_lastTotal;
+  if (steps < 0) {
+    steps = total;  // the daily total reset at midnight
+  }
+  s_lastTotal = total;
+
+  // Anything between the last bucket written and this one went unrecorded
+  // (the worker was stopped, or a timer ran late).
+  if (s_newest < bucket) {
+    uint32_t from = s_newest + 1;
+    if (bucket - from >= ACTIVITY_RING_BUCKETS) {
+      from = bucket - ACTIVITY_RING_BUCKETS + 1;
+    }
+    for (uint32_t b = from; b < bucket; b++) {
+      s_ring[b % ACTIVITY_RING_BUCKETS] = ACTIVITY_BUCKET_UNKNOWN;
+    }
+  }
+
+  uint8_t value = ACTIVITY_BUCKET_UNKNOWN;
+  if (s_primed) {
+    value = steps > ACTIVITY_BUCKET_MAX ? ACTIVITY_BUCKET_MAX : (uint8_t)steps;
+  }
+  s_primed = true;
+  s_ring[bucket % ACTIVITY_RING_BUCKETS] = value;
+  s_newest = bucket;
+
+  if (value != ACTIVITY_BUCKET_UNKNOWN) {
+    AppWorkerMessage msg = { .data0 = (uint16_t)(bucket & 0xFFFF), .data1 = value };
+    app_worker_send_message(WORKER_MSG_BUCKET, &msg);
+  }
+
+  if (++s_sinceSave >= PERSIST_EVERY_BUCKETS) {
+    persistRing();
+  }
+  scheduleNextBucket();
+}
+
+static void worker_message_handler(uint16_t type, AppWorkerMessage *data) {
+  if (type == WORKER_MSG_FLUSH) {
+    persistRing();
+    AppWorkerMessage msg = { .data0 = 0 };
+    app_worker_send_message(WORKER_MSG_FLUSHED, &msg);
+  }
+}
+
+static void worker_init() {
+  loadRing();
+  s_lastTotal = totalStepsToday();
+  app_worker_message_subscribe(worker_message_handler);
+  scheduleNextBucket();
+}
+
+static void worker_deinit() {
+  persistRing();
+  app_worker_message_unsubscribe();
+}
+
+int main(void) {
+  worker_init();
+  worker_event_loop();
+  worker_deinit();
+}